@@ -0,0 +1,30 @@
+#ifndef YADPCM_H
+#define YADPCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YAudio {
+
+/*
+ * Decoder for IMA ADPCM as stored in WAV files (format tag 0x11). Each block starts with a
+ * 4 byte header per channel (first sample and step index) followed by 4-bit codes, low nibble
+ * first. Stereo blocks interleave the channels 4 bytes (8 samples) at a time.
+ */
+static constexpr uint16_t ima_adpcm_format_tag = 0x11;
+
+// Number of frames in a full block
+inline size_t ima_adpcm_frames_per_block(uint16_t block_align, uint8_t channels) {
+    return (block_align - 4 * channels) * 2 / channels + 1;
+}
+
+/*
+ * Decodes one block (which may be cut short at the end of the data) into interleaved 16-bit
+ * frames. out must hold ima_adpcm_frames_per_block() frames. Returns the number of frames
+ * written.
+ */
+size_t ima_adpcm_decode_block(const uint8_t *block, size_t len, uint8_t channels, int16_t *out);
+
+}; // namespace YAudio
+
+#endif /* YADPCM_H */
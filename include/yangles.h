@@ -0,0 +1,40 @@
+#ifndef YANGLES_H
+#define YANGLES_H
+
+#include <stdint.h>
+
+namespace YOrientation {
+
+/*
+ * Angles are in hundredths of a degree, worked out from the direction of gravity:
+ *
+ *     pitch  nose up or down, from -9000 to 9000      atan2(-x, sqrt(y^2 + z^2))
+ *     roll   rotation about the x axis, -18000-18000  atan2(y, z)
+ *     tilt   angle away from lying flat, 0 to 18000   atan2(sqrt(x^2 + y^2), z)
+ *
+ * Only gravity is measured, so shaking or moving the board shows up as tilt. The low-pass
+ * filter smooths that out at the cost of following real changes a little later.
+ */
+typedef struct {
+    int16_t pitch;
+    int16_t roll;
+    int16_t tilt;
+    int16_t x; // Filtered acceleration in milli-g
+    int16_t y;
+    int16_t z;
+    uint32_t timestamp_us; // esp_timer time of the latest reading
+    uint32_t sequence;     // Readings so far, 0 before the first
+} estimate_t;
+
+// Works out the angles from an acceleration in milli-g (up to 16000 each way)
+void solve(int32_t x, int32_t y, int32_t z, estimate_t &estimate);
+
+// atan2 in hundredths of a degree, within 0.1 degree
+int16_t fast_atan2(int32_t y, int32_t x);
+
+// Square root rounded to the nearest whole number
+uint32_t fast_sqrt(uint32_t value);
+
+}; // namespace YOrientation
+
+#endif /* YANGLES_H */
@@ -5,21 +5,86 @@
 #include <stdint.h>
 #include <string>
 
+#include "yfilter.h"
+#include "yresample.h"
+#include "ysong.h"
+#include "yvoice.h"
+
 namespace YAudio {
 
+/*
+ * A sound built into the program, usually a WAV file turned into a const array by
+ * tools/embed_wav.py. Const arrays stay in flash and are played from there without copying.
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t size;
+} sound_asset_t;
+
+/*
+ * Sizes of the buffers used to play sound files, and where they go. Codecs and buffers are
+ * allocated the first time they are needed, so a program that never plays an MP3 file never
+ * pays for the MP3 decoder.
+ */
+typedef struct {
+    size_t file_block_bytes;  // Read from a file at a time, also the largest ADPCM block played
+    size_t prefetch_bytes;    // Read when a file is opened, for each of two open files
+    bool use_psram;           // Put the buffers in PSRAM, if the board has it
+    bool release_when_idle;   // Free codecs and buffers each time playback or recording ends
+} memory_config_t;
+
+typedef enum {
+    MEMORY_MP3_DECODER,   // Helix decoder and its frame buffers
+    MEMORY_ADPCM_DECODER, // Block of decoded IMA ADPCM samples
+    MEMORY_WAV_ENCODER,   // Recording encoder
+    MEMORY_FILE_BUFFERS,  // File reads and the prefetched start of each open file
+    MEMORY_I2S_BUFFERS,   // DMA buffers of the speaker and mic
+    MEMORY_EFFECTS,       // EQ, limiter, voice effects and resamplers, which are always present
+    MEMORY_COMPONENT_COUNT
+} memory_component_t;
+
+typedef struct {
+    size_t current; // Bytes in use now
+    size_t peak;    // Most bytes in use at any time
+} memory_usage_t;
+
 bool setup_speaker(int ws_pin, int bck_pin, int data_pin, int i2s_port);
 bool setup_mic(int ws_pin, int data_pin, int i2s_port);
 I2SStream &get_speaker_stream();
 I2SStream &get_mic_stream();
 void set_wave_volume(uint8_t volume);
+void set_resample_quality(Resampler::Quality quality);
+void set_effects_filter(int index, FilterType type, float frequency, float q, float gain_db);
+void set_effects_limiter(float threshold_db, float lookahead_ms, float release_ms);
+void set_effects_bypass(int stage, bool bypass);
+float get_effects_cycles_per_sample(int stage);
+bool configure_memory(const memory_config_t &config);
+void release_memory();
+memory_usage_t get_memory_usage(memory_component_t component);
 bool add_notes(const std::string &new_notes);
+bool play_song(const Song &song);
+bool play_song_file(const std::string &filename);
 void stop_speaker();
 bool is_playing();
-bool play_sound_file(const std::string &filename);
+bool play_sound_file(const std::string &filename, bool loop = false);
+bool play_buffer(const uint8_t *data, size_t len, bool loop = false);
+bool queue_sound_file(const std::string &filename);
+void set_loop(bool loop);
+bool open_sound_pack(const std::string &filename);
+int find_pack_sound(const std::string &name);
+bool play_pack_sound(int id, bool loop = false);
 bool start_recording(const std::string &filename);
 void stop_recording();
 bool is_recording();
+bool set_mic_rate(uint32_t rate);
+uint32_t get_mic_rate();
 void set_recording_gain(uint8_t new_gain);
+int16_t get_mic_level();
+bool start_monitor();
+bool is_monitoring();
+void set_monitor_volume(uint8_t volume);
+VoiceEffects &get_voice_effects();
+uint32_t measure_monitor_latency();
 }; // namespace YAudio
 
 #endif /* YAUDIO_H */
@@ -10,6 +10,11 @@
 #include <stdint.h>
 
 #include "yaudio.h"
+#include "ydatalog.h"
+#include "yi2c.h"
+#include "ymirror.h"
+#include "yorientation.h"
+#include "yscheduler.h"
 
 struct accelerometer_data {
     float x;
@@ -17,6 +22,14 @@ struct accelerometer_data {
     float z;
 };
 
+struct orientation_data {
+    float pitch; // Degrees, see get_orientation
+    float roll;
+    float tilt;
+    uint32_t timestamp_us;
+    bool valid;
+};
+
 class YBoardV3 {
   public:
     YBoardV3();
@@ -99,9 +112,81 @@ class YBoardV3 {
     /* This is similar to the function above, except that it will start the song playing
      * in the background and return immediately. The song will continue to play in the
      * background until it is stopped with the stop_audio function, another song is
-     * played, play_notes is called, or the song finishes.
+     * played, play_notes is called, or the song finishes. If loop is true, the song starts
+     * over each time it finishes, until it is stopped (see set_sound_file_loop).
      */
-    bool play_sound_file_background(const std::string &filename);
+    bool play_sound_file_background(const std::string &filename, bool loop = false);
+
+    /* This function plays a sound that is stored in memory rather than on the microSD card,
+     * so it works without a card and starts right away. The data is the contents of a WAV
+     * (PCM or IMA ADPCM) or MP3 file, and must not change or be freed until the sound
+     * finishes. The function will return once the sound has finished playing.
+     */
+    bool play_buffer(const uint8_t *data, size_t size);
+
+    /* This is similar to the function above, except that it will start the sound playing
+     * in the background and return immediately. If loop is true, the sound repeats until it is
+     * stopped.
+     */
+    bool play_buffer_background(const uint8_t *data, size_t size, bool loop = false);
+
+    /* This function plays a sound built into the program. Sounds are built in by turning a WAV
+     * file into a header file with the embed_wav.py tool in the tools folder, then including
+     * it. For example:
+     *
+     *     #include "beep.h" // Made with: python3 embed_wav.py beep.wav beep.h --name beep
+     *     Yboard.play_asset(beep);
+     *
+     * The function will return once the sound has finished playing.
+     */
+    bool play_asset(const YAudio::sound_asset_t &asset);
+
+    /* This is similar to the function above, except that it will start the sound playing
+     * in the background and return immediately. If loop is true, the sound repeats until it is
+     * stopped.
+     */
+    bool play_asset_background(const YAudio::sound_asset_t &asset, bool loop = false);
+
+    /* This function opens a sound pack, a single file on the microSD card holding many sounds,
+     * made with the pack_assets.py tool in the tools folder. Sounds in a pack start faster than
+     * separate files, since the card doesn't have to be searched for each one. A pack called
+     * sounds.ypak is opened automatically by setup. Opening a pack closes the previous one.
+     */
+    bool open_sound_pack(const std::string &filename);
+
+    /* This function returns the ID of a sound in the open sound pack, or -1 if the pack has no
+     * sound with that name. Names are the file names given to pack_assets.py, such as
+     * "beep.wav". Playing by ID skips looking up the name each time.
+     */
+    int get_sound_pack_id(const std::string &name);
+
+    /* These functions play a sound from the open sound pack, by name or by ID. They will
+     * return once the sound has finished playing.
+     */
+    bool play_sound_pack(const std::string &name);
+    bool play_sound_pack(int id);
+
+    /* These are similar to the functions above, except that they will start the sound playing
+     * in the background and return immediately. If loop is true, the sound repeats until it is
+     * stopped.
+     */
+    bool play_sound_pack_background(const std::string &name, bool loop = false);
+    bool play_sound_pack_background(int id, bool loop = false);
+
+    /* This function adds a sound file to the end of the playlist of files that are playing
+     * in the background. Each file starts the moment the one before it finishes, with no gap
+     * between them. If nothing is playing, the file starts playing right away.
+     */
+    bool queue_sound_file(const std::string &filename);
+
+    /* This function turns looping of the sound files that are playing on or off. When
+     * looping, the playlist starts over from the first file after the last one finishes (a
+     * single file repeats itself), without any gap. If a WAV file contains loop points, the
+     * part between them is repeated instead. Looping continues until stop_audio is called,
+     * looping is turned off, or another sound is started. Sounds start without looping unless
+     * the loop argument of the function that starts them is true.
+     */
+    void set_sound_file_loop(bool loop);
 
     /*
      * This function sets the speaker volume when playing a sound file. The volume
@@ -111,6 +196,69 @@ class YBoardV3 {
      */
     void set_sound_file_volume(uint8_t volume);
 
+    /*
+     * Sound files are converted to the speaker's sample rate as they play, so files of any
+     * sample rate (and mono or stereo) can be used. This function chooses the quality of that
+     * conversion. Fast uses the least CPU time, High sounds the best, and Balanced (the
+     * default) is in between.
+     */
+    void set_sound_file_quality(YAudio::Resampler::Quality quality);
+
+    /*
+     * Sound files can be shaped by up to 4 filters before they reach the speaker. The index
+     * (0-3) picks which filter to set. For example, the small speaker on the badge distorts on
+     * deep bass, which a HighPass filter at 150 Hz removes:
+     *
+     *     Yboard.set_sound_file_filter(0, YAudio::FilterType::HighPass, 150);
+     *
+     * LowShelf and HighShelf boost (positive gain_db) or cut (negative gain_db) everything
+     * below or above the frequency. Peaking boosts or cuts around the frequency, and a larger q
+     * makes the band narrower. Boosts are limited to 12 dB. FilterType::None turns the filter
+     * off.
+     */
+    void set_sound_file_filter(int index, YAudio::FilterType type, float frequency,
+                               float q = 0.707, float gain_db = 0);
+
+    /*
+     * This function turns the limiter for sound files on or off. The limiter turns down loud
+     * parts just before they happen so they don't exceed threshold_db (0 is the loudest the
+     * speaker can play), so loud files and boosting filters don't distort.
+     */
+    void set_sound_file_limiter(bool enabled, float threshold_db = -1);
+
+    /*
+     * This function returns the average number of processor cycles per sample spent in one
+     * sound file effect: 0-3 for the filters and 4 for the limiter. This is an advanced
+     * function for checking the cost of the effects.
+     */
+    float get_sound_file_effect_cycles(int stage);
+
+    /*
+     * This function sets how much memory is used to play sound files. file_block_bytes is read
+     * from the card at a time (at least 256, and ADPCM files need it to be at least their block
+     * size), and prefetch_bytes is read ahead when a file is opened so it starts quickly. With
+     * use_psram the buffers go in PSRAM on boards that have it. With release_when_idle the
+     * decoders and buffers are freed each time playback or recording ends, at the cost of
+     * setting them up again next time. It can't be called while a file plays or records.
+     */
+    bool set_audio_memory(size_t file_block_bytes, size_t prefetch_bytes, bool use_psram = false,
+                          bool release_when_idle = false);
+
+    /*
+     * This function frees the sound decoders and buffers that aren't in use right now. They
+     * are set up again the next time they are needed.
+     */
+    void release_audio_memory();
+
+    /*
+     * These functions report the memory the audio system is using now and the most it has
+     * used, for each part of it, in bytes. This is an advanced function for finding where
+     * memory goes in a large program. print_audio_memory prints all of them to the serial
+     * monitor.
+     */
+    YAudio::memory_usage_t get_audio_memory(YAudio::memory_component_t component);
+    void print_audio_memory();
+
     /* Plays the specified sequence of notes. The function will return once the notes
      * have finished playing.
      *
@@ -142,6 +290,37 @@ class YBoardV3 {
      */
     bool play_notes_background(const std::string &new_notes);
 
+    /* Plays a song that was converted from notes when the program was compiled. Songs are
+     * written with the same syntax as play_notes, but any mistakes are reported by the compiler,
+     * and playing them takes no time to parse and no extra memory. The function will return once
+     * the song has finished playing. For example:
+     *
+     *     static constexpr auto song = YSONG("T180 O5 C D E F G4");
+     *     Yboard.play_song(song);
+     *
+     * YSONG requires the project to be built with C++14 or newer (for example, by adding
+     * build_unflags = -std=gnu++11 and build_flags = -std=gnu++17 to platformio.ini).
+     */
+    bool play_song(const YAudio::Song &song);
+
+    /* This is similar to the function above, except that it will start playing the song
+     * in the background and return immediately. Any notes or sound file that are playing
+     * are stopped.
+     */
+    bool play_song_background(const YAudio::Song &song);
+
+    /* Plays a song file from the microSD card. Song files are made from notes with the
+     * song_convert tool in the tools folder. They are read a little at a time while they
+     * play, so they can be as long as you like and start playing right away. The function will
+     * return once the song has finished playing.
+     */
+    bool play_song_file(const std::string &filename);
+
+    /* This is similar to the function above, except that it will start playing the song
+     * in the background and return immediately.
+     */
+    bool play_song_file_background(const std::string &filename);
+
     /*
      * This function stops the audio from playing (either a song or a sequence of notes)
      */
@@ -187,15 +366,79 @@ class YBoardV3 {
      */
     void set_recording_volume(uint8_t volume);
 
+    /*
+     *  This function sets the sample rate of recordings, in samples per second. Lower rates
+     * make smaller files and use less of the processor. 16000 is plenty for speech, and 44100
+     * (the default) is CD quality. Supported rates are 8000, 11025, 12000, 16000, 22050,
+     * 24000, 44100, and 48000. The return type is a boolean value, true if the rate was
+     * changed. The rate can't be changed while recording or monitoring.
+     */
+    bool set_recording_rate(uint32_t rate);
+
     /*
      * This function returns the microphone stream object which can be used to take
      * control of the microphone, beyond recording to a file, which this
-     * library already provides. This is an advanced function. To see what you
+     * library already provides. The stream runs at 44100 or 48000 samples per second,
+     * whichever the recording rate divides into. This is an advanced function. To see what you
      * can do with a microphone stream object, you can view
      * https://github.com/pschatzmann/arduino-audio-tools.
      */
     I2SStream &get_microphone_stream();
 
+    /*
+     *  This function plays the microphone through the speaker as you speak, so the badge can be
+     * used as a megaphone or a voice changer. Any notes or sound file that are playing are
+     * stopped, and it can't be used while recording. It continues until stop_monitoring or
+     * stop_audio is called, or something else is played. The return type is a boolean value,
+     * true if monitoring started successfully.
+     */
+    bool start_monitoring();
+
+    /*
+     *  This function stops playing the microphone through the speaker.
+     */
+    void stop_monitoring();
+
+    /*
+     *  This function returns whether the microphone is being played through the speaker.
+     */
+    bool is_monitoring();
+
+    /*
+     *  This function sets the volume of the microphone when it is played through the speaker.
+     * The volume is an integer between 0 and 15. A volume of 0 is off. The default is 10.
+     */
+    void set_monitor_volume(uint8_t volume);
+
+    /*
+     *  This function changes the pitch of your voice while monitoring. The semitones are an
+     * integer between -12 (an octave lower) and 12 (an octave higher). 0 is your normal voice.
+     */
+    void set_voice_pitch(int semitones);
+
+    /*
+     *  This function makes your voice sound like a robot while monitoring. The frequency
+     * changes the sound of the robot, and values between 30 and 100 work well. A frequency of
+     * 0 turns the effect off.
+     */
+    void set_robot_voice(uint16_t frequency);
+
+    /*
+     *  This function adds an echo to your voice while monitoring. The delay is the time in
+     * milliseconds between echoes (up to 250). The amount is an integer between 0 and 9 that
+     * sets how loud each echo is, and 0 turns the effect off.
+     */
+    void set_voice_echo(uint16_t delay_ms, uint8_t amount);
+
+    /*
+     *  This function measures how long it takes for sound picked up by the microphone to come
+     * out of the speaker while monitoring. It sends a short click through the same path as
+     * your voice, including the voice effects and volume, and listens for it, so it works best
+     * in a quiet room with the volume up. The return value is the delay in milliseconds, or 0
+     * if it couldn't be measured.
+     */
+    float measure_monitor_latency();
+
     ///////////////////////////// Accelerometer ////////////////////////////////////
     /*
      *  This function returns whether accelerometer data is available.
@@ -213,9 +456,133 @@ class YBoardV3 {
      */
     accelerometer_data get_accelerometer();
 
+    /*
+     *  This function starts reading the accelerometer rate_hz times a second in the
+     * background and working out which way the board is tilted, for programs like marble
+     * games or a spirit level. The readings are smoothed so that shaking and noise don't make
+     * the angles jump around: smoothing_hz is how quickly the angles can change, where lower is
+     * steadier but slower to follow the board, and 0 turns the smoothing off. rate_hz can be up
+     * to max_accel_rate (672), and it can run alongside an accelerometer data log. The return
+     * type is a boolean value, true if it started successfully.
+     */
+    bool start_orientation(uint16_t rate_hz = 100, float smoothing_hz = 5);
+    void stop_orientation();
+
+    /*
+     *  This function returns the latest angles, in degrees, without waiting for the
+     * accelerometer, so it can be called as often as needed:
+     *
+     *     pitch  rotation about the accelerometer's y axis, from -90 to 90
+     *     roll   rotation about the accelerometer's x axis, from -180 to 180
+     *     tilt   how far the board is from lying flat, from 0 to 180
+     *
+     * timestamp_us is when the reading was taken, in micros(). valid is false until
+     * start_orientation has taken its first reading. get_orientation_estimate returns the
+     * same thing in hundredths of a degree, along with the smoothed acceleration.
+     */
+    orientation_data get_orientation();
+    YOrientation::estimate_t get_orientation_estimate();
+
+    ///////////////////////////// Data Logging ////////////////////////////////////
+    /*
+     *  This function starts logging sensor readings to a file on the microSD card. The
+     * config chooses how many times per second each sensor is read (0 leaves it out), for
+     * example:
+     *
+     *     YDataLog::config_t config = {};
+     *     config.rate_hz[YDataLog::CHANNEL_ACCELEROMETER] = 400;
+     *     config.rate_hz[YDataLog::CHANNEL_BUTTONS] = 50;
+     *     Yboard.start_data_log("/log.bin", config);
+     *
+     * Readings are taken in the background at a steady rate, even while the rest of the
+     * program is busy, and continue until stop_data_log is called. Each rate must divide the
+     * fastest one evenly, and the accelerometer can't be read more than max_accel_rate (672)
+     * times a second. The file is written in 512 byte blocks. Use tools/decode_datalog.py to
+     * convert it to a CSV file. The return type is a boolean value, true if logging started
+     * successfully.
+     */
+    bool start_data_log(const std::string &filename, const YDataLog::config_t &config);
+
+    /*
+     *  This function stops logging and saves the rest of the readings to the file.
+     */
+    void stop_data_log();
+
+    /*
+     *  This function returns whether sensor readings are being logged.
+     */
+    bool is_data_logging();
+
+    /*
+     *  This function returns counts of how many readings were logged, how many were lost
+     * because the microSD card couldn't keep up, and how many couldn't be read.
+     */
+    YDataLog::stats_t get_data_log_stats();
+
+    ///////////////////////////// Display ////////////////////////////////////////
+    /*
+     *  This function sends the contents of the display buffer to the screen. Draw on the
+     * display member with the Adafruit GFX functions, then call this function to show the
+     * result. The transfer shares the I2C bus with the accelerometer, and is split into
+     * small pieces so that accelerometer reads are not held up by a full screen refresh.
+     */
+    void update_display();
+
+    /*
+     *  This function turns on or off mirroring the display over the serial port. While it is
+     * on, each update_display also sends the parts of the screen that changed, compressed, to
+     * the computer, where tools/display_mirror.py shows them and reports how many bytes each
+     * frame took. Library messages and the mirror share the port: when the port is busy, the
+     * changes wait for a later update rather than slowing the program down.
+     */
+    bool set_display_mirror(bool enabled);
+    bool is_display_mirroring();
+
+    ///////////////////////////// Scheduler //////////////////////////////////////
+    /*
+     *  This function adds a function for the scheduler to call rate_hz times a second, such as
+     * reading the buttons at 200Hz, updating the LEDs at 60Hz and drawing the display at 30Hz:
+     *
+     *     Yboard.schedule("input", 200, read_input);
+     *     Yboard.schedule("display", 30, draw_display);
+     *
+     * budget_us is how long the function should take, in microseconds. Runs that take longer
+     * are counted as overruns. The default of 0 allows the whole time until the next call. The
+     * return value is an ID for get_scheduler_stats, or -1 if there are already 8 functions.
+     */
+    int schedule(const char *name, float rate_hz, const std::function<void()> &callback,
+                 uint32_t budget_us = 0);
+
+    /*
+     *  This function runs the scheduled functions forever, so it doesn't return. Call it at the
+     * end of setup, or from loop. Between calls the processor rests rather than spinning.
+     *
+     * While the scheduler runs, set_led_color, set_all_leds_color, set_led_brightness and
+     * update_display don't send anything right away. The LEDs and display are updated once at
+     * the end of each tick, after all of the functions due in it have run.
+     */
+    void run_scheduler();
+
+    /*
+     *  This is similar to the function above, except that it runs one tick and returns, for
+     * programs that have other work to do in loop.
+     */
+    void run_scheduler_once();
+
+    /*
+     *  These functions report how long each scheduled function has been taking and how late it
+     * started. print_scheduler_stats prints them all to the serial monitor.
+     */
+    bool get_scheduler_stats(int id, YScheduler::stats_t &stats);
+    void print_scheduler_stats();
+
     // Display
     Adafruit_SSD1306 display;
 
+    // I2C bus shared by the display and the accelerometer. All access to these devices
+    // should go through this object.
+    YI2C::Bus i2c;
+
     // LEDs
     static constexpr int led_pin = 5;
     static constexpr int led_count = 20;
@@ -230,9 +597,15 @@ class YBoardV3 {
     // I2C Connections
     static constexpr int sda_pin = 2;
     static constexpr int scl_pin = 1;
+    static constexpr uint32_t i2c_frequency = 400000;
 
     // I2C Devices
     static constexpr int accel_addr = 0x19;
+    static constexpr int display_addr = 0x3c;
+
+    // The most times a second the accelerometer can be read with a new reading each time. The
+    // accelerometer runs at least twice as fast as it is read, and its fastest rate is 1344Hz.
+    static constexpr uint16_t max_accel_rate = 672;
 
     // microSD Card Reader connections
     static constexpr int sd_cs_pin = 10;
@@ -254,17 +627,44 @@ class YBoardV3 {
   private:
     Adafruit_NeoPixel strip;
     SPARKFUN_LIS2DH12 accel;
-    bool wire_begin = false;
     bool sd_card_present = false;
+    YDataLog::Logger data_logger;
+    YOrientation::Service orientation;
+    uint16_t data_log_accel_rate = 0;
+    uint16_t orientation_rate = 0;
+
+    // The latest accelerometer reading, kept so the data log and orientation can both use it
+    // rather than each taking readings from the other. Only used from I2C jobs, which run one at
+    // a time. Each reader remembers the sequence number of the last reading it got.
+    int16_t accel_reading[3] = {};
+    uint32_t accel_sequence = 0;
+    uint32_t data_log_accel_sequence = 0;
+    uint32_t orientation_accel_sequence = 0;
+    YScheduler::Scheduler scheduler;
+    YMirror::DisplayMirror display_mirror;
+
+    // While the scheduler runs, LED and display changes are sent once at the end of each tick
+    bool defer_flush = false;
+    bool leds_dirty = false;
+    bool display_dirty = false;
 
     void setup_leds();
     void setup_switches();
     void setup_buttons();
     bool setup_speaker();
+    bool setup_sound_pack();
     bool setup_mic();
+    bool setup_i2c();
     bool setup_accelerometer();
     bool setup_sd_card();
     bool setup_display();
+    void show_leds();
+    void send_display();
+    void flush_outputs();
+    void update_accelerometer_rate();
+    bool read_new_acceleration(int16_t values[3], uint32_t &last_sequence);
+    static bool sample_data_log(YDataLog::channel_t channel, int16_t values[3], void *context);
+    static bool sample_orientation(int16_t values[3], void *context);
 };
 
 extern YBoardV3 Yboard;
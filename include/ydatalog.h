@@ -0,0 +1,114 @@
+#ifndef YDATALOG_H
+#define YDATALOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <esp_timer.h>
+#include <stdint.h>
+
+namespace YDataLog {
+
+/*
+ * Log files are a sequence of 512 byte blocks, each holding a header and up to
+ * records_per_block fixed size records. Unused space at the end of a block, and blocks after
+ * the end of the log (when the file was preallocated), are zero. tools/decode_datalog.py
+ * converts a log to CSV.
+ */
+static constexpr uint32_t block_magic = 0x474f4c59; // "YLOG"
+static constexpr size_t block_size = 512;
+static constexpr size_t records_per_block = 41;
+
+typedef enum : uint8_t {
+    CHANNEL_ACCELEROMETER, // x, y, z in milli-g
+    CHANNEL_KNOB,          // Position 0-100, raw ADC reading
+    CHANNEL_BUTTONS,       // Bit mask: button 1, button 2, switch 1, switch 2
+    CHANNEL_MIC_LEVEL,     // Peak level of recent microphone samples
+    CHANNEL_COUNT
+} channel_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp_us;
+    uint8_t channel;
+    uint8_t reserved;
+    int16_t values[3];
+} record_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t record_count;
+    uint16_t dropped; // Records lost since the previous block, to the card or failed reads
+    uint32_t reserved;
+    record_t records[records_per_block];
+    uint8_t padding[block_size - 16 - records_per_block * sizeof(record_t)];
+} block_t;
+
+static_assert(sizeof(block_t) == block_size, "Log blocks must be exactly one sector");
+
+typedef struct {
+    // Samples per second for each channel, or 0 to leave it out of the log. Channels are
+    // sampled on a tick at the fastest rate, so each rate must divide the fastest one evenly
+    // (for example 400, 100 and 50).
+    uint16_t rate_hz[CHANNEL_COUNT];
+    // Size to reserve for the file up front, so the card doesn't have to allocate space while
+    // logging. 0 to grow the file as it is written.
+    uint32_t preallocate_bytes;
+} config_t;
+
+typedef struct {
+    uint32_t records;
+    uint32_t dropped_records; // Every block was waiting on the card
+    uint32_t failed_reads;    // The channel had no reading to give
+    uint32_t missed_ticks;    // Sample times skipped because the sampling task ran late
+    uint32_t blocks_written;
+} stats_t;
+
+// Reads one channel into values. Returns false if the channel couldn't be read.
+typedef bool (*sample_cb_t)(channel_t channel, int16_t values[3], void *context);
+
+class Logger {
+  public:
+    static constexpr int block_count = 8;
+
+    /*
+     * Starts sampling in the background and writing blocks to file, which must already be open
+     * for writing. Takes ownership of the file and closes it when stopped.
+     */
+    bool start(File &file, const config_t &config, sample_cb_t sample, void *context);
+
+    /*
+     * Stops sampling, writes any remaining records and closes the file.
+     */
+    void stop();
+
+    bool is_running() const { return running; }
+    stats_t get_stats();
+
+  private:
+    File file;
+    sample_cb_t sample = nullptr;
+    void *sample_context = nullptr;
+    uint32_t dividers[CHANNEL_COUNT] = {};
+    esp_timer_handle_t timer = nullptr;
+    TaskHandle_t sampler_task_handle = nullptr;
+    QueueHandle_t free_blocks = nullptr;
+    QueueHandle_t full_blocks = nullptr;
+    block_t *blocks = nullptr;
+    block_t *current = nullptr;
+    uint32_t sequence = 0;
+    uint16_t dropped = 0;
+    volatile bool running = false;
+    volatile bool done = true;
+    portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+    stats_t stats = {}; // Updated by both tasks, so only used with stats_lock held
+
+    void add_record(uint32_t timestamp_us, channel_t channel, const int16_t values[3]);
+    void send_current_block();
+    static void timer_callback(void *params);
+    static void sampler_task(void *params);
+    static void writer_task(void *params);
+};
+
+}; // namespace YDataLog
+
+#endif /* YDATALOG_H */
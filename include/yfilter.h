@@ -0,0 +1,126 @@
+#ifndef YFILTER_H
+#define YFILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YAudio {
+
+enum class FilterType : uint8_t {
+    None,      // Passes audio through unchanged
+    HighPass,  // Removes frequencies below frequency
+    LowPass,   // Removes frequencies above frequency
+    LowShelf,  // Boosts or cuts frequencies below frequency by gain_db
+    HighShelf, // Boosts or cuts frequencies above frequency by gain_db
+    Peaking,   // Boosts or cuts a band around frequency by gain_db, q sets the width
+};
+
+/*
+ * Second order IIR filter (the Audio EQ Cookbook designs) for 16-bit mono audio. Coefficients
+ * are Q28 and the state keeps the rounding error of the previous output, so low frequency
+ * filters stay accurate at audio sample rates.
+ *
+ * Q28 holds coefficients up to 8, which the shelf and peaking designs reach at a 12 dB boost,
+ * so design() limits gain_db to max_gain_db. Cuts of any depth fit.
+ */
+class Biquad {
+  public:
+    static constexpr float max_gain_db = 12;
+
+    void design(FilterType type, uint32_t sample_rate, float frequency, float q, float gain_db);
+    void reset();
+    void process(int16_t *samples, size_t count);
+
+    FilterType get_type() const { return type; }
+
+  private:
+    FilterType type = FilterType::None;
+    int32_t b0 = 1 << 28;
+    int32_t b1 = 0;
+    int32_t b2 = 0;
+    int32_t a1 = 0;
+    int32_t a2 = 0;
+    int32_t x1 = 0;
+    int32_t x2 = 0;
+    int32_t y1 = 0;
+    int32_t y2 = 0;
+    int32_t error = 0;
+};
+
+/*
+ * Peak limiter that delays the audio by a short look-ahead so the gain is already down when a
+ * peak arrives, rather than clipping its start. The gain needed over the look-ahead window is
+ * tracked with a running minimum and smoothed with a moving average of the same length, which
+ * guarantees no sample exceeds the threshold, and then recovers over the release time.
+ */
+class Limiter {
+  public:
+    static constexpr size_t max_lookahead = 128;
+
+    void begin(uint32_t sample_rate, float lookahead_ms, float release_ms);
+    void set_threshold(float threshold_db);
+    void reset();
+    void process(int16_t *samples, size_t count);
+
+    // Current reduction in dB, 0 when the limiter is not acting
+    float get_gain_reduction_db() const;
+
+  private:
+    int32_t threshold = 32767;
+    uint16_t lookahead = 0;
+    int32_t release_coeff = 0; // Q15 fraction of the remaining gain recovered per sample
+    int32_t gain = 1 << 15;    // Q15
+
+    // Samples waiting to be output, and the gain each one needs
+    int16_t delay[max_lookahead + 1] = {};
+    int32_t needed[max_lookahead + 1] = {};
+    uint16_t pos = 0;
+
+    // Running minimum of needed, as a queue of positions with increasing gains
+    uint16_t min_queue[max_lookahead + 1] = {};
+    uint16_t min_head = 0;
+    uint16_t min_count = 0;
+
+    // Moving average of the running minimum
+    int32_t held[max_lookahead + 1] = {};
+    int32_t held_sum = 0;
+};
+
+/*
+ * A fixed chain of filters followed by a limiter, each of which can be bypassed. The time spent
+ * in each stage is measured in CPU cycles so the cost of the chain can be checked on the badge.
+ */
+class EffectsChain {
+  public:
+    static constexpr int max_filters = 4;
+    static constexpr int limiter_stage = max_filters; // Stage number of the limiter
+    static constexpr int stage_count = max_filters + 1;
+
+    void begin(uint32_t sample_rate);
+    void reset();
+
+    void set_filter(int index, FilterType type, float frequency, float q, float gain_db);
+    void set_limiter(float threshold_db, float lookahead_ms, float release_ms);
+
+    // Bypassed stages are skipped entirely. The limiter starts bypassed.
+    void set_bypass(int stage, bool bypass);
+    bool get_bypass(int stage) const;
+
+    void process(int16_t *samples, size_t count);
+
+    // Average CPU cycles per sample spent in a stage since the last reset_stats()
+    float get_cycles_per_sample(int stage) const;
+    void reset_stats();
+
+  private:
+    uint32_t sample_rate = 16000;
+    Biquad filters[max_filters];
+    Limiter limiter;
+    bool bypass[stage_count] = {false, false, false, false, true};
+    uint64_t cycles[stage_count] = {};
+    uint64_t samples_processed[stage_count] = {};
+};
+
+}; // namespace YAudio
+
+#endif /* YFILTER_H */
@@ -0,0 +1,50 @@
+#ifndef YGAIN_H
+#define YGAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YAudio {
+
+/*
+ * Applies gain to 16-bit audio in a single in-place pass, replacing separate volume and
+ * popping-removal passes. Gain changes are ramped over a few milliseconds so there is no zipper
+ * noise, the output saturates instead of wrapping when boosting, and the stage starts from
+ * silence so playback fades in instead of popping. fade_out() produces a short tail from the
+ * last sample back to zero for when a stream ends abruptly.
+ */
+class GainStage {
+  public:
+    static constexpr int32_t unity = 1 << 16; // Gain is Q16
+    static constexpr float max_gain = 15.0;
+
+    /*
+     * Starts the stage silent. The next process() call ramps up to the current gain.
+     */
+    void begin(uint16_t new_ramp_samples);
+
+    void set_gain(float gain);
+    float get_gain() const { return (float)target / unity; }
+
+    void process(int16_t *samples, size_t count);
+
+    /*
+     * Writes up to max_samples of a ramp from the last processed sample down to zero. Returns
+     * the number of samples written, which is 0 once the output has reached silence.
+     */
+    size_t fade_out(int16_t *out, size_t max_samples);
+
+  private:
+    int32_t target = unity;
+    int32_t current = 0;
+    int32_t step = 0;
+    uint16_t ramp_samples = 64;
+    uint16_t ramp_remaining = 0;
+    int16_t last = 0;
+
+    void start_ramp();
+};
+
+}; // namespace YAudio
+
+#endif /* YGAIN_H */
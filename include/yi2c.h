@@ -0,0 +1,117 @@
+#ifndef YI2C_H
+#define YI2C_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <functional>
+#include <stdint.h>
+
+namespace YI2C {
+
+// Transactions waiting at High priority are always serviced before any waiting at Low priority.
+// Sensor reads should use High, and bulk transfers (like display refreshes) should use Low.
+enum class Priority : uint8_t { High, Low };
+
+typedef void (*completion_cb_t)(bool success, void *context);
+
+typedef struct {
+    uint8_t address;
+    int16_t prefix; // Byte written before tx_data (register or control byte), or -1 for none
+    const uint8_t *tx_data;
+    size_t tx_len;
+    uint8_t *rx_data;
+    size_t rx_len;
+    completion_cb_t on_complete; // Called from the bus task when the transaction finishes
+    void *context;
+} transaction_t;
+
+typedef struct {
+    uint8_t address;
+    uint32_t transactions;
+    uint32_t errors;
+    uint32_t bytes;
+    uint32_t busy_us;     // Total time this device has held the bus
+    uint32_t max_wait_us; // Longest time a transaction for this device waited in the queue
+} device_stats_t;
+
+class Bus {
+  public:
+    static constexpr int max_devices = 8;
+
+    /*
+     * Starts the bus at the given clock frequency (400kHz fast mode or 1MHz fast mode plus) and
+     * creates the task that services queued transactions.
+     */
+    bool begin(int sda_pin, int scl_pin, uint32_t frequency);
+
+    void set_frequency(uint32_t frequency);
+    uint32_t get_frequency() const;
+
+    /*
+     * Queues a transaction and returns immediately. The buffers in the transaction must remain
+     * valid until on_complete is called.
+     */
+    bool submit(const transaction_t &transaction, Priority priority);
+
+    /*
+     * These functions queue a transaction and block until it has completed. They return whether
+     * the device acknowledged the transfer.
+     */
+    bool write(uint8_t address, const uint8_t *data, size_t len,
+               Priority priority = Priority::High);
+    bool write_read(uint8_t address, const uint8_t *tx_data, size_t tx_len, uint8_t *rx_data,
+                    size_t rx_len, Priority priority = Priority::High);
+
+    /*
+     * Writes a large buffer as a series of chunk_size transfers, each preceded by prefix. Each
+     * chunk is queued separately so that High priority transactions can be serviced in between.
+     * Blocks until every chunk has been sent.
+     */
+    bool write_bulk(uint8_t address, uint8_t prefix, const uint8_t *data, size_t len,
+                    size_t chunk_size, Priority priority = Priority::Low);
+
+    /*
+     * Runs job on the bus task with exclusive access to the bus. This is used to wrap drivers
+     * that talk to Wire directly. The job is accounted to address in the statistics.
+     */
+    bool run(uint8_t address, const std::function<bool()> &job,
+             Priority priority = Priority::High);
+
+    bool get_device_stats(uint8_t address, device_stats_t &stats);
+
+    /*
+     * Returns the fraction (0.0 to 1.0) of time the bus has been busy since the statistics were
+     * last reset.
+     */
+    float get_utilization();
+    void reset_stats();
+
+    TwoWire &wire() { return Wire; }
+
+  private:
+    typedef struct {
+        transaction_t transaction;
+        const std::function<bool()> *job;
+        uint32_t queued_us;
+    } request_t;
+
+    QueueHandle_t high_queue = nullptr;
+    QueueHandle_t low_queue = nullptr;
+    TaskHandle_t task_handle = nullptr;
+    portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+    device_stats_t devices[max_devices] = {};
+    int device_count = 0;
+    uint32_t stats_start_us = 0;
+    uint32_t frequency = 100000;
+
+    bool enqueue(const request_t &request, Priority priority);
+    bool enqueue_and_wait(request_t &request, Priority priority);
+    bool execute(request_t &request);
+    void record(uint8_t address, bool success, uint32_t bytes, uint32_t wait_us,
+                uint32_t busy_us);
+    static void bus_task(void *params);
+};
+
+}; // namespace YI2C
+
+#endif /* YI2C_H */
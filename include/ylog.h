@@ -0,0 +1,171 @@
+#ifndef YLOG_H
+#define YLOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+
+/*
+ * Messages below YLOG_LEVEL are removed when the library is compiled. Define it (for example
+ * with -DYLOG_LEVEL=YLOG_LEVEL_ERROR in build_flags) to keep only the more severe messages.
+ */
+#define YLOG_LEVEL_DEBUG 0
+#define YLOG_LEVEL_INFO 1
+#define YLOG_LEVEL_WARNING 2
+#define YLOG_LEVEL_ERROR 3
+#define YLOG_LEVEL_NONE 4
+
+#ifndef YLOG_LEVEL
+#define YLOG_LEVEL YLOG_LEVEL_INFO
+#endif
+
+namespace YLog {
+
+/*
+ * Library messages are printed to Serial by a background task, so a message never makes the
+ * code that reports it wait on the serial port. Logging copies the format string's address and
+ * the arguments into a fixed size record in a ring that any task can add to without locking,
+ * and the background task formats and prints each record later. If the ring is full, the
+ * record is dropped and counted rather than waiting.
+ *
+ * The format must be a string literal, since only its address is kept. It takes printf
+ * conversions (%d, %u, %x, %c, %s, %f and so on) and up to max_args arguments. Integers are
+ * stored as 32 bits, floating point as float, and strings are copied into the record (up to
+ * max_text bytes for all of them, after which they are cut short). The message is printed as
+ * its own line.
+ *
+ * Logging is safe from any task, but not from interrupts.
+ */
+typedef enum : uint8_t {
+    LEVEL_DEBUG = YLOG_LEVEL_DEBUG,
+    LEVEL_INFO = YLOG_LEVEL_INFO,
+    LEVEL_WARNING = YLOG_LEVEL_WARNING,
+    LEVEL_ERROR = YLOG_LEVEL_ERROR,
+    LEVEL_NONE = YLOG_LEVEL_NONE,
+} level_t;
+
+static constexpr size_t max_args = 6;
+static constexpr size_t max_text = 60;
+static constexpr size_t ring_records = 32;
+
+typedef struct {
+    const char *format;
+    uint32_t time_ms;
+    level_t level;
+    uint8_t arg_count;
+    uint8_t text_used;
+    uint32_t args[max_args]; // Integers, float bits, or the offset of a string in text
+    char text[max_text];
+} record_t;
+
+/*
+ * Starts the task that prints messages. Logging starts it if it hasn't been started, but
+ * starting it from setup() keeps that out of time critical code.
+ */
+bool begin();
+
+// Messages less severe than this are skipped when logged. Defaults to LEVEL_DEBUG, so only
+// YLOG_LEVEL removes messages.
+void set_level(level_t level);
+level_t get_level();
+
+// Messages dropped because the ring was full
+uint32_t get_dropped();
+
+/*
+ * Writes binary data to Serial between messages, so the two can share the port. This never
+ * waits: if a message is being printed or the port's buffer doesn't have room for all of the
+ * data, nothing is written and it returns false. Without a transmit buffer the room is only
+ * the UART's 128 byte FIFO, so writes longer than max_binary_write may never fit.
+ */
+static constexpr size_t max_binary_write = 128;
+
+bool write_binary(const uint8_t *data, size_t len);
+
+// The rest is used by the macros below
+extern volatile level_t runtime_level;
+void submit(const record_t &record);
+void add_text(record_t &record, const char *text);
+
+inline void add_arg(record_t &record, const char *text) { add_text(record, text); }
+
+inline void add_arg(record_t &record, const std::string &text) { add_text(record, text.c_str()); }
+
+inline void add_arg(record_t &record, double value) {
+    union {
+        float f;
+        uint32_t u;
+    } bits;
+    bits.f = (float)value;
+    record.args[record.arg_count++] = bits.u;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+add_arg(record_t &record, T value) {
+    record.args[record.arg_count++] = (uint32_t)value;
+}
+
+inline void capture(record_t &) {}
+
+template <typename T, typename... Rest>
+inline void capture(record_t &record, const T &value, const Rest &...rest) {
+    add_arg(record, value);
+    capture(record, rest...);
+}
+
+template <typename... Args> void log(level_t level, const char *format, const Args &...args) {
+    static_assert(sizeof...(Args) <= max_args, "Too many arguments to log");
+
+    record_t record;
+    record.format = format;
+    record.level = level;
+    record.arg_count = 0;
+    record.text_used = 0;
+    capture(record, args...);
+    submit(record);
+}
+
+}; // namespace YLog
+
+#define YLOG_AT(level, ...)                                                                    \
+    do {                                                                                       \
+        if ((level) >= YLog::runtime_level) {                                                  \
+            YLog::log((level), __VA_ARGS__);                                                   \
+        }                                                                                      \
+    } while (0)
+
+#if YLOG_LEVEL <= YLOG_LEVEL_DEBUG
+#define YLOG_DEBUG(...) YLOG_AT(YLog::LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define YLOG_DEBUG(...)                                                                        \
+    do {                                                                                       \
+    } while (0)
+#endif
+
+#if YLOG_LEVEL <= YLOG_LEVEL_INFO
+#define YLOG_INFO(...) YLOG_AT(YLog::LEVEL_INFO, __VA_ARGS__)
+#else
+#define YLOG_INFO(...)                                                                         \
+    do {                                                                                       \
+    } while (0)
+#endif
+
+#if YLOG_LEVEL <= YLOG_LEVEL_WARNING
+#define YLOG_WARNING(...) YLOG_AT(YLog::LEVEL_WARNING, __VA_ARGS__)
+#else
+#define YLOG_WARNING(...)                                                                      \
+    do {                                                                                       \
+    } while (0)
+#endif
+
+#if YLOG_LEVEL <= YLOG_LEVEL_ERROR
+#define YLOG_ERROR(...) YLOG_AT(YLog::LEVEL_ERROR, __VA_ARGS__)
+#else
+#define YLOG_ERROR(...)                                                                        \
+    do {                                                                                       \
+    } while (0)
+#endif
+
+#endif /* YLOG_H */
@@ -0,0 +1,70 @@
+#ifndef YMIRROR_H
+#define YMIRROR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YMirror {
+
+/*
+ * The display is streamed as packets, one for each segment (up to segment_width columns of a
+ * page of 8 rows) that changed, followed by an end of frame packet. Segments keep every packet
+ * small enough for the serial port to take at once. tools/display_mirror.py decodes them. All
+ * values are little-endian:
+ *
+ *     sync (0xA5 0x5A), type, frame (2 bytes), page, x, width, length (2 bytes),
+ *     payload (length bytes), checksum (2 bytes, Fletcher-16 of type through payload)
+ *
+ * x is the segment's first column and width is the display's. Key packets ('K') hold the
+ * segment itself and delta packets ('D') hold it XORed with the last copy that was sent, so
+ * unchanged pixels are zero. Either is run-length encoded: a control byte c below 128 is
+ * followed by c + 1 bytes to copy, and c from 128 up is followed by one byte to repeat c - 125
+ * times. End packets ('E') have no payload, and give the number of pages in place of the page.
+ *
+ * A segment that couldn't be sent, because the serial port was busy, stays different from what
+ * was last sent and goes out with the next frame. Every page is also sent as key packets now
+ * and then, so a receiver that starts late or loses a packet catches up.
+ */
+static constexpr uint8_t sync_bytes[2] = {0xA5, 0x5A};
+static constexpr uint8_t packet_key = 'K';
+static constexpr uint8_t packet_delta = 'D';
+static constexpr uint8_t packet_end = 'E';
+static constexpr size_t header_size = 10;
+static constexpr size_t checksum_size = 2;
+static constexpr int segment_width = 64;
+
+class DisplayMirror {
+  public:
+    static constexpr int max_width = 128;
+    static constexpr int max_pages = 8;
+    static constexpr int max_segments = max_pages * (max_width / segment_width);
+
+    bool begin(int width, int pages);
+    void end();
+    bool is_running() const { return sent != nullptr; }
+
+    // Sends the pages of the frame buffer that differ from what was sent before
+    void send(const uint8_t *buffer);
+
+    // Bytes handed to the serial port, and pages that had to wait for a later frame
+    uint32_t get_bytes_sent() const { return bytes_sent; }
+    uint32_t get_pages_deferred() const { return pages_deferred; }
+
+  private:
+    int width = 0;
+    int pages = 0;
+    uint8_t *sent = nullptr; // What the receiver has for each page
+    uint16_t key_due = 0;    // Bit mask of segments to send whole
+    uint8_t first_page = 0;  // Where the next frame starts, so no page always goes last
+    uint16_t frame = 0;
+    uint32_t bytes_sent = 0;
+    uint32_t pages_deferred = 0;
+
+    int segments_per_page() const { return (width + segment_width - 1) / segment_width; }
+    bool send_segment(int page, int x, int len, const uint8_t *data, bool key);
+    bool send_packet(uint8_t type, uint8_t page, uint8_t x, const uint8_t *payload, size_t len);
+};
+
+}; // namespace YMirror
+
+#endif /* YMIRROR_H */
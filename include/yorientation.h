@@ -0,0 +1,55 @@
+#ifndef YORIENTATION_H
+#define YORIENTATION_H
+
+#include "yangles.h"
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <stdint.h>
+
+namespace YOrientation {
+
+typedef struct {
+    uint32_t samples;
+    uint32_t failed_reads;
+    uint32_t missed_ticks; // Sample times skipped because the task ran late
+} stats_t;
+
+// Reads the accelerometer into values (x, y, z in milli-g). Returns false if it couldn't.
+typedef bool (*sample_cb_t)(int16_t values[3], void *context);
+
+/*
+ * Reads the accelerometer at a fixed rate in the background, filters the readings and works
+ * out the angles, so get() only has to copy the latest estimate. cutoff_hz is the filter's
+ * corner frequency: lower is smoother and slower to follow the board. 0 turns it off.
+ */
+class Service {
+  public:
+    bool start(uint16_t rate_hz, float cutoff_hz, sample_cb_t sample, void *context);
+    void stop();
+    bool is_running() const { return running; }
+
+    estimate_t get();
+    stats_t get_stats();
+
+  private:
+    sample_cb_t sample = nullptr;
+    void *sample_context = nullptr;
+    int32_t alpha = 0;        // Filter weight of each new reading, out of 1 << 16
+    int32_t filtered[3] = {}; // Milli-g, times 16
+    esp_timer_handle_t timer = nullptr;
+    TaskHandle_t task_handle = nullptr;
+    portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+    estimate_t latest = {};
+    volatile bool running = false;
+    volatile bool done = true;
+    stats_t stats = {};
+
+    void update(const int16_t values[3], uint32_t timestamp_us);
+    static void timer_callback(void *params);
+    static void sampler_task(void *params);
+};
+
+}; // namespace YOrientation
+
+#endif /* YORIENTATION_H */
@@ -0,0 +1,71 @@
+#ifndef YPACK_H
+#define YPACK_H
+
+#include <FS.h>
+#include <stdint.h>
+#include <vector>
+
+namespace YAudio {
+
+/*
+ * A sound pack (.ypak) is a single file holding many sounds, made by tools/pack_assets.py, so
+ * playing a sound doesn't have to search the card's directories. The file is little-endian:
+ *
+ *     header:  'Y' 'P' 'A' 'K', version (1 byte), 3 reserved bytes, entry_count (4 bytes),
+ *              names_size (4 bytes)
+ *     entries: entry_count x { name_hash, offset, length (4 bytes each), format (1 byte),
+ *              3 reserved bytes }
+ *     names:   names_size bytes of zero-terminated names, in entry order
+ *     data:    each sound's file contents at its offset, aligned to 512 bytes
+ *
+ * name_hash is the 32-bit FNV-1a hash of the name. The packer makes sure no two names in a pack
+ * share a hash, but a name that isn't in the pack can still match one, so the name is compared
+ * too.
+ */
+static constexpr uint8_t pack_file_version = 1;
+static constexpr size_t pack_header_size = 16;
+static constexpr size_t pack_entry_size = 16;
+
+typedef enum : uint8_t { PACK_FORMAT_WAV, PACK_FORMAT_MP3 } pack_format_t;
+
+typedef struct {
+    uint32_t name_hash;
+    uint32_t offset;
+    uint32_t length;
+    pack_format_t format;
+} pack_entry_t;
+
+/*
+ * Holds the index and names of an open sound pack in RAM, with a hash table from name to entry,
+ * so finding a sound takes the same short time however many the pack holds. The pack file stays
+ * open and sounds are played by seeking within it.
+ */
+class AssetPack {
+  public:
+    bool open(File &file);
+    void close();
+    bool is_open() const { return !entries.empty(); }
+
+    // Returns the ID of the named sound, or -1 if it is not in the pack
+    int find(const char *name) const;
+
+    // Returns null if there is no sound with that ID
+    const pack_entry_t *get(int id) const;
+
+    size_t size() const { return entries.size(); }
+    File &get_file() { return file; }
+
+    static uint32_t hash_name(const char *name);
+
+  private:
+    File file;
+    std::vector<pack_entry_t> entries;
+    std::vector<char> names;
+    std::vector<uint32_t> name_offsets; // Where each entry's name starts in names
+    std::vector<uint16_t> table; // Entry ID + 1 for each slot, 0 if the slot is empty
+    uint32_t table_mask = 0;
+};
+
+}; // namespace YAudio
+
+#endif /* YPACK_H */
@@ -0,0 +1,126 @@
+#ifndef YRESAMPLE_H
+#define YRESAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace YAudio {
+
+/*
+ * Streaming polyphase sample rate converter for 16-bit mono audio. The filter coefficients are
+ * computed once in begin(), after which conversion only uses integer arithmetic. The rate ratio
+ * is tracked exactly, so there is no drift however long the stream plays.
+ */
+class Resampler {
+  public:
+    enum class Quality : uint8_t {
+        Fast,     // Linear interpolation, no anti-alias filtering
+        Balanced, // 8 tap windowed sinc
+        High,     // 24 tap windowed sinc
+    };
+
+    bool begin(uint32_t in_rate, uint32_t out_rate, Quality quality);
+
+    /*
+     * Clears the filter history, for example before starting an unrelated stream.
+     */
+    void reset();
+
+    /*
+     * Converts up to in_count input samples, writing at most out_capacity output samples.
+     * in_used is set to the number of input samples consumed, and the number of output samples
+     * written is returned. Unused input should be passed again on the next call.
+     */
+    size_t process(const int16_t *in, size_t in_count, size_t &in_used, int16_t *out,
+                   size_t out_capacity);
+
+    /*
+     * Returns the largest number of output samples that in_count input samples can produce.
+     */
+    size_t max_output(size_t in_count) const;
+
+    bool is_passthrough() const { return in_rate == out_rate; }
+    uint32_t get_in_rate() const { return in_rate; }
+    uint32_t get_out_rate() const { return out_rate; }
+    Quality get_quality() const { return quality; }
+
+  private:
+    uint32_t in_rate = 0;
+    uint32_t out_rate = 0;
+    Quality quality = Quality::Balanced;
+
+    // The ratio in_rate / out_rate, reduced, as a whole part and a remainder
+    uint32_t ratio_in = 1;
+    uint32_t ratio_out = 1;
+    uint32_t step_int = 1;
+    uint32_t step_rem = 0;
+
+    uint32_t phase_acc = 0; // Position between input samples, in units of 1/ratio_out
+    uint32_t skip = 1;      // Input samples to consume before the next output
+
+    uint16_t taps = 0;
+    uint16_t phases = 0;
+    std::vector<int16_t> coefficients; // phases x taps, Q15
+    std::vector<int16_t> history;      // Stored twice so the filter window is never split
+    uint16_t history_pos = 0;
+
+    int16_t filter(uint32_t phase) const;
+};
+
+/*
+ * Reduces the sample rate of 16-bit mono audio by a whole factor made of 2s and 3s (2, 3, 4, 6,
+ * 8, 12, ...). Each factor is a separate stage with a short linear phase filter cut off at the
+ * stage's new Nyquist frequency. Those filters have every 2nd (or 3rd) tap equal to zero, and
+ * are symmetric, so each output sample costs only a quarter (or a third) of the multiplies that
+ * a general filter of the same length would. Coefficients are computed once in begin(), after
+ * which decimation only uses integer arithmetic.
+ */
+class Decimator {
+  public:
+    static constexpr int max_stages = 4;
+
+    /*
+     * Returns false if in_rate is not out_rate times a supported factor.
+     */
+    bool begin(uint32_t in_rate, uint32_t out_rate);
+
+    void reset();
+
+    /*
+     * Decimates count input samples, writing at most count / get_factor() + 1 output samples.
+     * Returns the number of output samples written. in and out may point to the same buffer.
+     */
+    size_t process(const int16_t *in, size_t count, int16_t *out);
+
+    uint32_t get_factor() const { return factor; }
+
+  private:
+    typedef struct {
+        uint8_t factor;
+        uint8_t phase; // Input samples since the last output
+        uint16_t taps;
+        uint16_t history_pos;
+        int16_t center;                    // Q15
+        std::vector<uint8_t> offsets;      // Distance from the center of each nonzero tap pair
+        std::vector<int16_t> coefficients; // Q15, one per pair
+        std::vector<int16_t> history;      // Stored twice so the filter window is never split
+    } stage_t;
+
+    uint32_t factor = 1;
+    stage_t stages[max_stages];
+    int stage_count = 0;
+
+    void add_stage(uint8_t stage_factor);
+    static size_t process_stage(stage_t &stage, const int16_t *in, size_t count, int16_t *out);
+};
+
+/*
+ * Mixes interleaved 16-bit frames down to mono by averaging the channels. in and out may point
+ * to the same buffer.
+ */
+void downmix_to_mono(const int16_t *in, int16_t *out, size_t frames, uint8_t channels);
+
+}; // namespace YAudio
+
+#endif /* YRESAMPLE_H */
@@ -0,0 +1,88 @@
+#ifndef YSCHEDULER_H
+#define YSCHEDULER_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <functional>
+#include <stdint.h>
+
+namespace YScheduler {
+
+typedef struct {
+    uint32_t runs;
+    uint32_t overruns; // Runs that took longer than the budget
+    uint32_t missed;   // Ticks skipped because the callback was already late
+    uint32_t last_us;  // How long the latest run took
+    uint32_t max_us;   // and the longest
+    uint32_t average_us;
+    uint32_t max_jitter_us; // Most a run started after it was due
+    uint32_t average_jitter_us;
+} stats_t;
+
+/*
+ * Runs callbacks at fixed rates from one task, such as reading input at 200Hz, updating LEDs at
+ * 60Hz and redrawing the display at 30Hz. Each tick runs every callback that is due, in the
+ * order they were added, then calls the flush function once so outputs changed by several
+ * callbacks are sent to the hardware together. Between ticks the task blocks on a timer, so
+ * the CPU is free for other tasks or idles.
+ *
+ * Each callback's run time is measured against its budget, and its start against when it was
+ * due, so a slow callback in a large program can be found. A callback that falls more than a
+ * period behind skips the ticks it missed rather than running several times in a row, and
+ * keeps to its original schedule.
+ */
+class Scheduler {
+  public:
+    static constexpr int max_callbacks = 8;
+
+    ~Scheduler();
+
+    /*
+     * Adds a callback to run rate_hz times a second. A budget of 0 allows the whole period.
+     * Returns the callback's ID, or -1 if there are already max_callbacks.
+     */
+    int add(const char *name, float rate_hz, const std::function<void()> &callback,
+            uint32_t budget_us = 0);
+
+    // Called at the end of each tick in which any callback ran
+    void set_flush(const std::function<void()> &flush);
+
+    // Waits for the next tick and runs it
+    void run_once();
+
+    int size() const { return count; }
+    const char *get_name(int id) const;
+    uint32_t get_budget(int id) const;
+    bool get_stats(int id, stats_t &stats) const;
+    stats_t get_flush_stats() const;
+    void reset_stats();
+
+  private:
+    typedef struct {
+        const char *name;
+        std::function<void()> callback;
+        uint32_t period_us;
+        uint32_t budget_us;
+        int64_t next_due;
+        stats_t stats;
+        uint64_t total_us;
+        uint64_t total_jitter_us;
+    } entry_t;
+
+    entry_t entries[max_callbacks];
+    int count = 0;
+    bool started = false;
+    std::function<void()> flush;
+    stats_t flush_stats = {};
+    uint64_t flush_total_us = 0;
+    esp_timer_handle_t timer = nullptr;
+    SemaphoreHandle_t wake = nullptr;
+
+    void sleep_until(int64_t time);
+    static void record_run(stats_t &stats, uint64_t &total_us, uint32_t duration_us);
+    static void timer_callback(void *params);
+};
+
+}; // namespace YScheduler
+
+#endif /* YSCHEDULER_H */
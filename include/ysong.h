@@ -0,0 +1,309 @@
+#ifndef YSONG_H
+#define YSONG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YAudio {
+
+typedef struct {
+    uint16_t frequency; // Hz, or 0 for a rest
+    uint16_t duration;  // Milliseconds
+    uint8_t volume;     // 1-10
+} note_event_t;
+
+template <size_t N> struct SongData {
+    note_event_t events[N ? N : 1];
+};
+
+/*
+ * A song is a table of note events, usually produced at compile time by YSONG and stored in
+ * flash. A Song only points at the table, so the table must outlive any playback of it. Songs
+ * can't be made from a temporary table, such as YSONG(...) passed straight to play_song, so
+ * store the table in a static constexpr variable first.
+ */
+struct Song {
+    const note_event_t *events;
+    size_t length;
+
+    constexpr Song(const note_event_t *song_events, size_t song_length)
+        : events(song_events), length(song_length) {}
+
+    template <size_t N> constexpr Song(const SongData<N> &data) : events(data.events), length(N) {}
+    template <size_t N> Song(const SongData<N> &&) = delete;
+};
+
+/*
+ * Binary song files (.ysong) hold the same events as a Song so they can be streamed from the SD
+ * card. The file is a header followed by event_count packed events, all little-endian:
+ *
+ *     header: 'Y' 'S' 'N' 'G', version (1 byte), 3 reserved bytes, event_count (4 bytes)
+ *     event:  frequency (2 bytes), duration (2 bytes), volume (1 byte)
+ */
+static constexpr uint8_t song_file_version = 1;
+static constexpr size_t song_file_header_size = 12;
+static constexpr size_t song_file_event_size = 5;
+
+inline void encode_song_header(uint32_t event_count, uint8_t *out) {
+    out[0] = 'Y';
+    out[1] = 'S';
+    out[2] = 'N';
+    out[3] = 'G';
+    out[4] = song_file_version;
+    out[5] = out[6] = out[7] = 0;
+    for (int i = 0; i < 4; i++) {
+        out[8 + i] = (uint8_t)(event_count >> (8 * i));
+    }
+}
+
+// Returns false if the header is not a supported song file
+inline bool decode_song_header(const uint8_t *in, uint32_t &event_count) {
+    if (in[0] != 'Y' || in[1] != 'S' || in[2] != 'N' || in[3] != 'G' ||
+        in[4] != song_file_version) {
+        return false;
+    }
+    event_count = in[8] | (in[9] << 8) | (in[10] << 16) | ((uint32_t)in[11] << 24);
+    return true;
+}
+
+inline void encode_song_event(const note_event_t &event, uint8_t *out) {
+    out[0] = (uint8_t)event.frequency;
+    out[1] = (uint8_t)(event.frequency >> 8);
+    out[2] = (uint8_t)event.duration;
+    out[3] = (uint8_t)(event.duration >> 8);
+    out[4] = event.volume;
+}
+
+inline note_event_t decode_song_event(const uint8_t *in) {
+    return {(uint16_t)(in[0] | (in[1] << 8)), (uint16_t)(in[2] | (in[3] << 8)), in[4]};
+}
+
+#if __cplusplus >= 201402L
+
+namespace song_detail {
+
+enum class Status : uint8_t { Event, End, Error };
+
+typedef struct {
+    const char *text;
+    size_t pos;
+    int tempo;
+    int octave;
+    int volume;
+} state_t;
+
+// Deliberately not constexpr: reaching it while compiling a song turns the syntax error into a
+// compile error that names this function.
+inline void invalid_song_syntax() {}
+
+constexpr state_t start(const char *text) { return {text, 0, 120, 5, 5}; }
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+// Reads a decimal number, returning -1 if there isn't one
+constexpr long read_number(state_t &st) {
+    if (!is_digit(st.text[st.pos])) {
+        return -1;
+    }
+
+    long value = 0;
+    while (is_digit(st.text[st.pos]) && value < 100000) {
+        value = value * 10 + (st.text[st.pos++] - '0');
+    }
+    return value;
+}
+
+constexpr double note_frequency(char note) {
+    switch (note) {
+    case 'A':
+    case 'a':
+        return 440.0;
+    case 'B':
+    case 'b':
+        return 493.88;
+    case 'C':
+    case 'c':
+        return 523.25;
+    case 'D':
+    case 'd':
+        return 587.33;
+    case 'E':
+    case 'e':
+        return 659.25;
+    case 'F':
+    case 'f':
+        return 698.46;
+    case 'G':
+    case 'g':
+        return 783.99;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Parses the next note in the same syntax as play_notes(). Unlike play_notes(), values that are
+ * out of range are reported as errors rather than ignored.
+ */
+constexpr Status next_event(state_t &st, note_event_t &event) {
+    const double half_step = 1.0594630943592953; // 2^(1/12)
+
+    while (st.text[st.pos]) {
+        char c = st.text[st.pos];
+
+        if (is_space(c)) {
+            st.pos++;
+            continue;
+        }
+
+        // Octave
+        if (c == 'O' || c == 'o') {
+            int new_octave = st.text[st.pos + 1] - '0';
+            if (new_octave < 4 || new_octave > 7) {
+                return Status::Error;
+            }
+            st.octave = new_octave;
+            st.pos += 2;
+            continue;
+        }
+
+        // Tempo
+        if (c == 'T' || c == 't') {
+            st.pos++;
+            long new_tempo = read_number(st);
+            if (new_tempo < 40 || new_tempo > 240) {
+                return Status::Error;
+            }
+            st.tempo = (int)new_tempo;
+            continue;
+        }
+
+        // Reset
+        if (c == '!') {
+            st.tempo = 120;
+            st.octave = 5;
+            st.volume = 5;
+            st.pos++;
+            continue;
+        }
+
+        // Volume
+        if (c == 'V' || c == 'v') {
+            st.pos++;
+            long new_volume = read_number(st);
+            if (new_volume < 1 || new_volume > 10) {
+                return Status::Error;
+            }
+            st.volume = (int)new_volume;
+            continue;
+        }
+
+        bool rest = (c == 'R' || c == 'r');
+        if (!rest && note_frequency(c) == 0) {
+            return Status::Error;
+        }
+
+        double frequency = note_frequency(c);
+        for (int i = 4; i < st.octave; i++) {
+            frequency *= 2;
+        }
+        st.pos++;
+
+        double duration_s = 60.0 / st.tempo; // Quarter note duration in seconds
+        double dot_duration = duration_s;
+
+        // Note modifiers
+        while (1) {
+            c = st.text[st.pos];
+
+            if (is_digit(c)) {
+                long fraction = read_number(st);
+                if (fraction < 1 || fraction > 2000) {
+                    return Status::Error;
+                }
+                duration_s = duration_s * (4.0 / fraction);
+            } else if (c == '.') {
+                dot_duration /= 2;
+                duration_s += dot_duration;
+                st.pos++;
+            } else if (c == '>') {
+                frequency *= 2;
+                st.pos++;
+            } else if (c == '<') {
+                frequency /= 2;
+                st.pos++;
+            } else if (c == '#' || c == '+') {
+                frequency *= half_step;
+                st.pos++;
+            } else if (c == '-') {
+                frequency /= half_step;
+                st.pos++;
+            } else {
+                break;
+            }
+        }
+
+        double duration_ms = duration_s * 1000;
+        if (frequency + 0.5 > UINT16_MAX || duration_ms >= UINT16_MAX + 1.0) {
+            return Status::Error;
+        }
+
+        event.frequency = rest ? 0 : (uint16_t)(frequency + 0.5);
+        event.duration = (uint16_t)duration_ms;
+        event.volume = (uint8_t)st.volume;
+        return Status::Event;
+    }
+
+    return Status::End;
+}
+
+constexpr size_t count_events(const char *text) {
+    state_t st = start(text);
+    note_event_t event{};
+    size_t count = 0;
+
+    while (1) {
+        Status status = next_event(st, event);
+        if (status == Status::End) {
+            return count;
+        }
+        if (status == Status::Error) {
+            invalid_song_syntax();
+            return count;
+        }
+        count++;
+    }
+}
+
+template <size_t N> constexpr SongData<N> compile_song(const char *text) {
+    SongData<N> data{};
+    state_t st = start(text);
+
+    for (size_t i = 0; i < N; i++) {
+        next_event(st, data.events[i]);
+    }
+    return data;
+}
+
+}; // namespace song_detail
+
+/*
+ * Converts a string literal of notes (in the syntax documented for play_notes) into a table of
+ * note events at compile time. Malformed notes cause a compile error. Store the result in a
+ * static constexpr variable so that it is built by the compiler and placed in flash:
+ *
+ *     static constexpr auto my_song = YSONG("T180 O5 C D E F G4");
+ *     Yboard.play_song(my_song);
+ */
+#define YSONG(notes)                                                                               \
+    (::YAudio::song_detail::compile_song<::YAudio::song_detail::count_events(notes)>(notes))
+
+#endif
+
+}; // namespace YAudio
+
+#endif /* YSONG_H */
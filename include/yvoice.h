@@ -0,0 +1,71 @@
+#ifndef YVOICE_H
+#define YVOICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace YAudio {
+
+/*
+ * Real-time voice effects for 16-bit mono audio, applied in place and in fixed point so they
+ * are cheap enough to run on every block of a live microphone stream. Each effect is off until
+ * it is set, and processing with every effect off leaves the samples untouched.
+ *
+ *  - Pitch shift: two read heads sweep a short delay line at the new speed, crossfading so the
+ *    jump when a head wraps around is silent. This adds up to pitch_window samples of delay.
+ *  - Robot: ring modulation with a low frequency sine wave.
+ *  - Echo: a delay line fed back into itself.
+ *
+ * The setters may be called from another task while audio is being processed.
+ */
+class VoiceEffects {
+  public:
+    static constexpr size_t max_echo_samples = 4096;
+    static constexpr size_t pitch_window = 256;
+
+    void begin(uint32_t sample_rate);
+
+    /*
+     * Clears the delay lines, so the previous audio doesn't leak into a new stream.
+     */
+    void reset();
+
+    // Pitch ratio between 0.5 (an octave down) and 2.0 (an octave up). 1.0 turns it off.
+    void set_pitch(float ratio);
+
+    // Frequency of the modulating tone in Hz. 0 turns it off.
+    void set_robot(uint16_t frequency);
+
+    // Delay is limited to max_echo_samples. Feedback is between 0 and 0.9. A delay of 0 or a
+    // feedback of 0 turns it off.
+    void set_echo(uint16_t delay_ms, float feedback);
+
+    void process(int16_t *samples, size_t count);
+
+  private:
+    uint32_t sample_rate = 16000;
+
+    // Pitch shift
+    int16_t pitch_buffer[pitch_window] = {};
+    uint16_t pitch_write = 0;
+    uint32_t pitch_delay = 0;        // Q16 samples
+    volatile int32_t pitch_step = 0; // Q16 change in delay per sample, 0 when off
+
+    // Robot
+    uint32_t robot_phase = 0;
+    volatile uint32_t robot_step = 0; // Fraction of a cycle per sample, 0 when off
+
+    // Echo
+    int16_t echo_buffer[max_echo_samples] = {};
+    uint16_t echo_pos = 0;
+    volatile uint16_t echo_delay = 0;
+    volatile int16_t echo_feedback = 0; // Q15
+
+    void process_pitch(int16_t *samples, size_t count);
+    void process_robot(int16_t *samples, size_t count);
+    void process_echo(int16_t *samples, size_t count);
+};
+
+}; // namespace YAudio
+
+#endif /* YVOICE_H */
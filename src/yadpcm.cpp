@@ -0,0 +1,106 @@
+#include "yadpcm.h"
+
+namespace YAudio {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+static const int16_t STEP_TABLE[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,
+    25,    28,    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,
+    88,    97,    107,   118,   130,   143,   157,   173,   190,   209,   230,   253,   279,
+    307,   337,   371,   408,   449,   494,   544,   598,   658,   724,   796,   876,   963,
+    1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,  2272,  2499,  2749,  3024,  3327,
+    3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static const int8_t INDEX_TABLE[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int MAX_CHANNELS = 2;
+
+typedef struct {
+    int32_t predictor;
+    int32_t index;
+} channel_state_t;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static inline int16_t decode_nibble(channel_state_t &state, uint8_t nibble);
+
+////////////////////////////// Public Functions ///////////////////////////////
+size_t ima_adpcm_decode_block(const uint8_t *block, size_t len, uint8_t channels, int16_t *out) {
+    if (channels < 1 || channels > MAX_CHANNELS || len < 4u * channels) {
+        return 0;
+    }
+
+    // The header holds the first sample of each channel
+    channel_state_t state[MAX_CHANNELS];
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        const uint8_t *header = block + 4 * ch;
+        state[ch].predictor = (int16_t)(header[0] | (header[1] << 8));
+        state[ch].index = header[2] > 88 ? 88 : header[2];
+        out[ch] = (int16_t)state[ch].predictor;
+    }
+
+    const uint8_t *data = block + 4 * channels;
+    size_t data_len = len - 4 * channels;
+    size_t frames = 1;
+
+    if (channels == 1) {
+        for (size_t i = 0; i < data_len; i++) {
+            out[frames++] = decode_nibble(state[0], data[i] & 0x0F);
+            out[frames++] = decode_nibble(state[0], data[i] >> 4);
+        }
+        return frames;
+    }
+
+    // Stereo: 4 bytes of the left channel, then 4 bytes of the right, for 8 frames
+    for (size_t group = 0; group + 8 <= data_len; group += 8) {
+        for (uint8_t ch = 0; ch < 2; ch++) {
+            const uint8_t *codes = data + group + 4 * ch;
+            int16_t *dest = out + frames * 2 + ch;
+            for (int i = 0; i < 4; i++) {
+                dest[(2 * i) * 2] = decode_nibble(state[ch], codes[i] & 0x0F);
+                dest[(2 * i + 1) * 2] = decode_nibble(state[ch], codes[i] >> 4);
+            }
+        }
+        frames += 8;
+    }
+    return frames;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+int16_t decode_nibble(channel_state_t &state, uint8_t nibble) {
+    int32_t step = STEP_TABLE[state.index];
+
+    int32_t diff = step >> 3;
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 8) {
+        diff = -diff;
+    }
+
+    state.predictor += diff;
+    if (state.predictor > INT16_MAX) {
+        state.predictor = INT16_MAX;
+    } else if (state.predictor < INT16_MIN) {
+        state.predictor = INT16_MIN;
+    }
+
+    state.index += INDEX_TABLE[nibble];
+    if (state.index < 0) {
+        state.index = 0;
+    } else if (state.index > 88) {
+        state.index = 88;
+    }
+
+    return (int16_t)state.predictor;
+}
+
+}; // namespace YAudio
@@ -0,0 +1,106 @@
+#include "yangles.h"
+
+namespace YOrientation {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Readings are clamped to the accelerometer's largest range, which keeps the sums of squares
+// within 32 bits
+static const int32_t MAX_MILLI_G = 16000;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static inline int32_t clamp_milli_g(int32_t value);
+static inline int32_t scaled_length(int32_t a, int32_t b, int &shift);
+
+////////////////////////////// Public Functions ///////////////////////////////
+void solve(int32_t x, int32_t y, int32_t z, estimate_t &estimate) {
+    x = clamp_milli_g(x);
+    y = clamp_milli_g(y);
+    z = clamp_milli_g(z);
+
+    int shift;
+    int32_t yz = scaled_length(y, z, shift);
+    estimate.pitch = fast_atan2(-x * (1 << shift), yz);
+    int32_t xy = scaled_length(x, y, shift);
+    estimate.tilt = fast_atan2(xy, z * (1 << shift));
+    estimate.roll = fast_atan2(y, z);
+    estimate.x = x;
+    estimate.y = y;
+    estimate.z = z;
+}
+
+// Reduces to an angle between 0 and 45 degrees, where
+// atan(t) ~= 45t + t(1 - t)(14.02 + 3.80t) degrees is within 0.09 degrees
+int16_t fast_atan2(int32_t y, int32_t x) {
+    uint32_t ax = x < 0 ? -(uint32_t)x : x;
+    uint32_t ay = y < 0 ? -(uint32_t)y : y;
+    if (ax == 0 && ay == 0) {
+        return 0;
+    }
+
+    // Only the ratio matters, and keeping both within 16 bits leaves room to divide
+    while (ax > 0xFFFF || ay > 0xFFFF) {
+        ax >>= 1;
+        ay >>= 1;
+    }
+
+    bool steep = ay > ax;
+    uint32_t t = steep ? (ax << 15) / ay : (ay << 15) / ax; // 0 to 1, times 1 << 15
+    int32_t u = (t * ((1 << 15) - t)) >> 15;
+    int32_t angle = (4500 * t + u * (1402 + ((380 * t) >> 15)) + (1 << 14)) >> 15;
+
+    if (steep) {
+        angle = 9000 - angle;
+    }
+    if (x < 0) {
+        angle = 18000 - angle;
+    }
+    return y < 0 ? -angle : angle;
+}
+
+uint32_t fast_sqrt(uint32_t value) {
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value) {
+        bit >>= 2;
+    }
+
+    while (bit) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // Round up when value is past root * root + root, halfway to the next square
+    return value > root ? root + 1 : root;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+int32_t clamp_milli_g(int32_t value) {
+    if (value > MAX_MILLI_G) {
+        return MAX_MILLI_G;
+    }
+    if (value < -MAX_MILLI_G) {
+        return -MAX_MILLI_G;
+    }
+    return value;
+}
+
+// sqrt(a^2 + b^2) times 1 << shift, where shift is as large as 32 bits allow. A weak reading's
+// length rounded to a whole milli-g would be off by up to 0.15 degrees as an angle.
+int32_t scaled_length(int32_t a, int32_t b, int &shift) {
+    uint32_t sum = (uint32_t)(a * a) + (uint32_t)(b * b);
+    shift = 0;
+    while (sum < (1UL << 28) && shift < 8) {
+        sum <<= 2;
+        shift++;
+    }
+    return fast_sqrt(sum);
+}
+
+}; // namespace YOrientation
@@ -1,10 +1,21 @@
+#include "yadpcm.h"
 #include "yaudio.h"
+#include "yfilter.h"
+#include "ygain.h"
+#include "ylog.h"
+#include "ypack.h"
+#include "yresample.h"
+#include "yvoice.h"
 
 #include <Arduino.h>
 #include <AudioTools/AudioCodecs/CodecMP3Helix.h>
 #include <AudioTools/AudioCodecs/CodecWAV.h>
 #include <FS.h>
 #include <SD.h>
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <new>
+#include <vector>
 
 namespace YAudio {
 
@@ -12,6 +23,39 @@ namespace YAudio {
 
 static const int MAX_NOTES_IN_BUFFER = 4000;
 
+// Number of events read from a song file at a time
+static const int SONG_FILE_READ_AHEAD = 32;
+
+// Default bytes of a sound file read per block (which is also the largest IMA ADPCM block that
+// can be played), and read ahead of time when a sound file is opened
+static const size_t FILE_BLOCK_BYTES = 1024;
+static const size_t TRACK_PREFETCH_BYTES = 2048;
+static const size_t MIN_FILE_BLOCK_BYTES = 256;
+static const int MAX_PLAYLIST_LENGTH = 32;
+
+// Number of frames converted at a time when adapting decoded audio to the speaker format
+static const int FORMAT_BLOCK_FRAMES = 128;
+static const int MAX_SOURCE_CHANNELS = 8;
+
+// Gain changes and fades are spread over this many samples (4ms at the speaker rate)
+static const int GAIN_RAMP_SAMPLES = 64;
+static const int TONE_BLOCK_SAMPLES = 128;
+static const int MIC_BLOCK_SAMPLES = 256;
+static const int MIC_LEVEL_SAMPLES = 64;
+
+// Monitoring swaps in short I2S queues so little audio waits between the mic and the speaker:
+// 4 x 1.5ms on the mic and 4 x 2ms on the speaker
+static const int MONITOR_DMA_BUFFER_COUNT = 4;
+static const int MONITOR_MIC_DMA_BYTES = 128;
+static const int MONITOR_SPEAKER_DMA_BYTES = 64;
+static const int MONITOR_BLOCK_SAMPLES = 64;
+
+// Latency is measured by playing a short click and listening for it
+static const int LATENCY_CLICK_SAMPLES = 32;
+static const int16_t LATENCY_CLICK_LEVEL = 20000;
+static const int LATENCY_MIN_THRESHOLD = 256;
+static const int64_t LATENCY_TIMEOUT_US = 200000;
+
 // This is the sequence of notes to play
 static std::string notes;
 
@@ -23,18 +67,31 @@ static int volume_notes;
 typedef struct {
     unsigned int frequency;
     unsigned int duration;
+    unsigned int volume;
 } note_t;
 
+// Compiled song being played, which takes priority over the notes string
+static const note_event_t *song_events = nullptr;
+static size_t song_length = 0;
+static size_t song_position = 0;
+
+// Song file being streamed from the SD card
+static File song_file;
+static uint32_t song_file_remaining = 0;
+static uint8_t song_file_buffer[SONG_FILE_READ_AHEAD * song_file_event_size];
+static size_t song_file_buffered = 0;
+static size_t song_file_next = 0;
+
 // Note playing task
 static TaskHandle_t play_speaker_task_handle;
 static SemaphoreHandle_t notes_mutex;
 
-// General stream variables
-static StreamCopy copier;
-
 // Variables for speaker
 static I2SStream speakerOut;
-static PoppingSoundRemover<int16_t> poppingRemover(1, true, true);
+static I2SConfig speaker_config;
+static GainStage speakerGain;
+static EffectsChain speakerEffects;
+static float wave_volume = 1.0;
 
 // Variables for tone generation
 static AudioInfo sineInfo(16000, 1, 16);
@@ -42,36 +99,245 @@ static SineWaveGenerator<int16_t> sineWave(16000);
 static GeneratedSoundStream<int16_t> toneStream(sineWave);
 static bool playing_tones = false;
 
-// Variables for audio file decoding
-static File sound_file;
-static VolumeStream speakerVolume(speakerOut);
-static EncodedAudioStream wav_decoder(&speakerVolume, new WAVDecoder());
-static EncodedAudioStream mp3_decoder(&speakerVolume, new MP3DecoderHelix());
+// Converts decoded audio of any rate and channel count to the fixed speaker format (sineInfo),
+// so files never force the I2S output to be reconfigured, then runs it through the effects chain
+// and gain stage.
+class OutputFormatStream : public AudioStream {
+  public:
+    OutputFormatStream(Print &out, EffectsChain &out_effects, GainStage &out_gain)
+        : output(out), effects(out_effects), gain(out_gain) {}
+
+    bool begin() override {
+        source = sineInfo;
+        pending_bytes = 0;
+        return resampler.begin(source.sample_rate, sineInfo.sample_rate, quality);
+    }
+
+    void setAudioInfo(AudioInfo new_info) override {
+        // Record the source format, but don't pass it on to the speaker
+        if (new_info.sample_rate != source.sample_rate || new_info.channels != source.channels ||
+            new_info.bits_per_sample != source.bits_per_sample) {
+            source = new_info;
+            pending_bytes = 0;
+            resampler.begin(source.sample_rate, sineInfo.sample_rate, quality);
+        }
+    }
+
+    void set_source(AudioDecoder *decoder) { source_decoder = decoder; }
+
+    void set_quality(Resampler::Quality new_quality) {
+        quality = new_quality;
+        resampler.begin(source.sample_rate, sineInfo.sample_rate, quality);
+    }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        if (source_decoder) {
+            setAudioInfo(source_decoder->audioInfo());
+        }
+
+        if (source.bits_per_sample != 16 || source.channels < 1 ||
+            source.channels > MAX_SOURCE_CHANNELS) {
+            YLOG_ERROR("Unsupported audio format");
+            return len;
+        }
+
+        size_t frame_bytes = source.channels * sizeof(int16_t);
+        size_t consumed = 0;
+
+        // Complete any frame that was split across writes
+        if (pending_bytes) {
+            size_t n = min(frame_bytes - pending_bytes, len);
+            memcpy(pending + pending_bytes, data, n);
+            pending_bytes += n;
+            consumed += n;
+            if (pending_bytes < frame_bytes) {
+                return len;
+            }
+            convert(pending, 1);
+            pending_bytes = 0;
+        }
+
+        while (len - consumed >= frame_bytes) {
+            size_t frames = min((size_t)FORMAT_BLOCK_FRAMES, (len - consumed) / frame_bytes);
+            convert(data + consumed, frames);
+            consumed += frames * frame_bytes;
+        }
+
+        memcpy(pending, data + consumed, len - consumed);
+        pending_bytes = len - consumed;
+
+        return len;
+    }
+
+  private:
+    Print &output;
+    EffectsChain &effects;
+    GainStage &gain;
+    AudioDecoder *source_decoder = nullptr;
+    AudioInfo source = sineInfo;
+    Resampler resampler;
+    Resampler::Quality quality = Resampler::Quality::Balanced;
+    int16_t frames_in[FORMAT_BLOCK_FRAMES * MAX_SOURCE_CHANNELS];
+    int16_t frames_out[FORMAT_BLOCK_FRAMES];
+    uint8_t pending[MAX_SOURCE_CHANNELS * sizeof(int16_t)];
+    size_t pending_bytes = 0;
+
+    void convert(const uint8_t *data, size_t frames) {
+        // Copy first, since decoder buffers are not guaranteed to be aligned
+        memcpy(frames_in, data, frames * source.channels * sizeof(int16_t));
+        downmix_to_mono(frames_in, frames_in, frames, source.channels);
+
+        size_t offset = 0;
+        while (offset < frames) {
+            size_t used;
+            size_t produced = resampler.process(frames_in + offset, frames - offset, used,
+                                                frames_out, FORMAT_BLOCK_FRAMES);
+            effects.process(frames_out, produced);
+            gain.process(frames_out, produced);
+            output.write((const uint8_t *)frames_out, produced * sizeof(int16_t));
+            offset += used;
+        }
+    }
+};
+
+// Variables for audio file decoding. WAV files are parsed here rather than by a decoder so that
+// loop points can be read and one file can be spliced onto the next without a gap. Sounds can
+// also be played from memory (including const arrays in flash), which is read in place, or from
+// a sound pack, where each sound is a region of the one pack file.
+typedef enum { FORMAT_WAV, FORMAT_WAV_ADPCM, FORMAT_MP3 } sound_format_t;
+
+typedef struct {
+    std::string filename;
+    const uint8_t *data; // Sound in memory, or null to open filename
+    size_t size;
+    int pack_id; // Sound in the sound pack, or -1
+} playlist_entry_t;
+
+typedef struct {
+    File file;
+    bool shared_file;      // The file is the sound pack, which stays open
+    const uint8_t *memory; // Set instead of file for sounds in memory
+    uint32_t base;         // Where the sound starts in the file
+    uint32_t size;
+    sound_format_t format;
+    AudioInfo info; // WAV only, MP3 reports its format through the decoder
+    uint16_t block_align;
+    uint32_t frame_count; // ADPCM frames to play, from the fact chunk, as the last block is padded
+    uint32_t data_start;
+    uint32_t data_end;
+    uint32_t loop_start; // From the WAV smpl chunk. loop_end is 0 if there is no loop.
+    uint32_t loop_end;
+    uint32_t position; // Next byte of the file to play
+    uint8_t *prefetch; // memory_config.prefetch_bytes, allocated with the file buffers
+    size_t prefetch_len;
+} track_t;
+
+static OutputFormatStream speakerFormat(speakerOut, speakerEffects, speakerGain);
+static MP3DecoderHelix *mp3_codec = nullptr; // Created the first time an MP3 file is played
+static EncodedAudioStream *mp3_decoder = nullptr;
+static bool mp3_decoder_active = false;
 static bool playing_file = false;
 
+// The current file and the next one in the playlist, which is opened while the current one plays
+static SemaphoreHandle_t playback_mutex;
+static track_t tracks[2];
+static track_t *current_track = &tracks[0];
+static track_t *next_track = &tracks[1];
+static int next_track_index = -1;
+static std::vector<playlist_entry_t> playlist;
+static AssetPack soundPack;
+static size_t playlist_index = 0;
+static bool loop_playback = false;
+static uint8_t *file_block = nullptr;   // Allocated the first time a file is played
+static int16_t *adpcm_block = nullptr;  // Allocated the first time an ADPCM sound is played
+
+// Variables for memory use. Codecs and buffers are allocated when first needed, and released
+// with release_memory() or, if configured, whenever playback or recording ends.
+static memory_config_t memory_config = {FILE_BLOCK_BYTES, TRACK_PREFETCH_BYTES, false, false};
+static memory_usage_t memory_usage[MEMORY_COMPONENT_COUNT];
+static size_t speaker_dma_bytes = 0;
+static size_t mic_dma_bytes = 0;
+static size_t mp3_created_bytes = 0; // Heap used by creating the MP3 decoder
+static size_t mp3_begin_bytes = 0;   // and by starting it, which is when Helix allocates
+
 // Variables for microphone
 static File speaker_recording_file;
+// The mic is captured at micInfo and decimated to recordInfo, the rate chosen by the user
 static AudioInfo micInfo(44100, 1, 16);
+static AudioInfo recordInfo(44100, 1, 16);
+static Decimator micDecimator;
 static I2SStream micIn;
-static VolumeStream micVolume(micIn);
+static I2SConfig mic_config;
+static GainStage micGain;
+static volatile int16_t mic_peak = 0;
 
-// Variables for recording
-static EncodedAudioStream wav_encoder(&speaker_recording_file, new WAVEncoder());
+// Variables for recording. The encoder is created when recording starts.
+static WAVEncoder *wav_codec = nullptr;
+static EncodedAudioStream *wav_encoder = nullptr;
 static bool recording_audio = false;
 static bool done_recording_audio = true;
 
+// Variables for live monitoring (mic to speaker)
+typedef enum {
+    LATENCY_IDLE,
+    LATENCY_REQUESTED,
+    LATENCY_LISTENING,
+    LATENCY_DONE
+} latency_state_t;
+
+static bool monitoring = false;
+static float monitor_volume = 10;
+static Resampler monitorResampler;
+static VoiceEffects voiceEffects;
+static volatile latency_state_t latency_state = LATENCY_IDLE;
+static uint32_t latency_result_us = 0;
+static int64_t latency_click_time = 0;
+static int32_t latency_threshold = 0;
+
 //////////////////////////// Private Function Prototypes ///////////////////////
 // Local private functions
 static void play_speaker_task(void *params);
 static void recording_audio_task(void *params);
+static bool next_note(note_t &note);
 static note_t parse_next_note();
+static bool read_song_file_event(note_event_t &event);
+static void close_song_file();
+static bool play_entry(const playlist_entry_t &entry, bool loop);
+static bool open_track(track_t &track, const playlist_entry_t &entry);
+static size_t read_track_at(track_t &track, uint32_t offset, uint8_t *data, size_t len);
+static bool parse_wav_header(track_t &track);
+static bool is_track_open(const track_t &track);
+static void close_track(track_t &track);
+static void start_track(track_t &track);
+static size_t read_track(track_t &track, size_t len, const uint8_t *&data);
+static void write_track(track_t &track, const uint8_t *data, size_t len);
+static int next_playlist_index();
+static void prepare_next_track();
+static bool advance_track();
+static uint32_t read_le32(const uint8_t *data);
+static uint16_t read_le16(const uint8_t *data);
 static void set_note_defaults();
+static void write_speaker(int16_t *samples, size_t count);
+static void fade_out_speaker();
+static int16_t peak_level(const int16_t *samples, size_t count);
+static void monitor_loop();
+static void check_latency_click(const int16_t *samples, size_t count, int64_t read_time);
+static void *allocate_buffer(size_t bytes);
+static void free_buffer(void *buffer);
+static void set_memory_usage(memory_component_t component, size_t bytes);
+static size_t heap_used_since(size_t free_before);
+static void update_i2s_memory(const I2SConfig *speaker, const I2SConfig *mic);
+static bool allocate_file_buffers();
+static bool allocate_adpcm_buffer();
+static bool create_mp3_decoder();
+static void release_playback_memory();
+static void release_recording_memory();
 
 ////////////////////////////// Public Functions ///////////////////////////////
 bool setup_speaker(int ws_pin, int bck_pin, int data_pin, int i2s_port) {
     set_note_defaults();
 
-    Serial.println("starting I2S...");
+    YLOG_INFO("starting I2S...");
     auto config = speakerOut.defaultConfig(TX_MODE);
     config.copyFrom(sineInfo);
     config.pin_ws = ws_pin;
@@ -80,10 +346,14 @@ bool setup_speaker(int ws_pin, int bck_pin, int data_pin, int i2s_port) {
     config.port_no = i2s_port;
 
     speakerOut.begin(config);
-    speakerVolume.begin(config);
+    speaker_config = config;
+    update_i2s_memory(&speaker_config, nullptr);
+    speakerFormat.begin();
+    speakerEffects.begin(sineInfo.sample_rate);
 
-    // Create the mutex for notes string
+    // Create the mutexes for notes string and sound files
     notes_mutex = xSemaphoreCreateMutex();
+    playback_mutex = xSemaphoreCreateMutex();
 
     // Create task that will actually do the playing
     xTaskCreate(play_speaker_task, "play_speaker_task", 4096, NULL, 1, &play_speaker_task_handle);
@@ -101,25 +371,37 @@ bool setup_mic(int ws_pin, int data_pin, int i2s_port) {
     config.pin_ws = ws_pin;
     config.pin_data = data_pin;
 
-    auto volumeConfig = micVolume.defaultConfig();
-    volumeConfig.copyFrom(micInfo);
-    volumeConfig.allow_boost = true;
-
     micIn.begin(config);
-    micVolume.begin(volumeConfig);
+    mic_config = config;
+    update_i2s_memory(nullptr, &mic_config);
 
     return true;
 }
 
 bool start_recording(const std::string &filename) {
     if (recording_audio) {
-        Serial.println("Already recording audio");
+        YLOG_ERROR("Already recording audio");
         return false;
     }
 
+    if (monitoring) {
+        YLOG_ERROR("Can't record while monitoring the microphone");
+        return false;
+    }
+
+    if (!wav_encoder) {
+        size_t free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        wav_codec = new WAVEncoder();
+        wav_encoder = new EncodedAudioStream(&speaker_recording_file, wav_codec);
+        set_memory_usage(MEMORY_WAV_ENCODER, heap_used_since(free_before));
+    }
+
     speaker_recording_file = SD.open(filename.c_str(), FILE_WRITE);
     if (!speaker_recording_file) {
-        Serial.println("Error opening/creating file for recording.");
+        YLOG_ERROR("Error opening/creating file for recording.");
+        if (memory_config.release_when_idle) {
+            release_recording_memory();
+        }
         return false;
     }
 
@@ -134,16 +416,29 @@ bool start_recording(const std::string &filename) {
 }
 
 void recording_audio_task(void *params) {
-    wav_encoder.begin(micInfo);
-    copier.begin(wav_encoder, micVolume);
+    int16_t block[MIC_BLOCK_SAMPLES];
+
+    wav_encoder->begin(recordInfo);
+    micDecimator.reset();
+    micGain.begin(GAIN_RAMP_SAMPLES);
 
     while (recording_audio) {
-        copier.copy();
+        size_t bytes = micIn.readBytes((uint8_t *)block, sizeof(block));
+        size_t count = micDecimator.process(block, bytes / sizeof(int16_t), block);
+        micGain.process(block, count);
+        int16_t peak = peak_level(block, count);
+        if (peak > mic_peak) {
+            mic_peak = peak;
+        }
+        wav_encoder->write((const uint8_t *)block, count * sizeof(int16_t));
     }
 
     speaker_recording_file.flush();
     speaker_recording_file.close();
-    wav_encoder.end();
+    wav_encoder->end();
+    if (memory_config.release_when_idle) {
+        release_recording_memory();
+    }
 
     // Indicate to the main task that we are done
     done_recording_audio = true;
@@ -164,7 +459,55 @@ void stop_recording() {
 
 bool is_recording() { return recording_audio; }
 
-void set_recording_gain(uint8_t new_gain) { micVolume.setVolume(new_gain); }
+bool set_mic_rate(uint32_t rate) {
+    if (recording_audio || monitoring) {
+        YLOG_ERROR("Can't change the mic rate while it is in use");
+        return false;
+    }
+
+    // Capture at whichever of the standard rates the requested rate divides evenly
+    uint32_t capture_rate;
+    Decimator decimator;
+    if (rate && 48000 % rate == 0 && decimator.begin(48000, rate)) {
+        capture_rate = 48000;
+    } else if (rate && 44100 % rate == 0 && decimator.begin(44100, rate)) {
+        capture_rate = 44100;
+    } else {
+        YLOG_ERROR("Unsupported mic rate: %u", (unsigned)rate);
+        return false;
+    }
+
+    if (capture_rate != (uint32_t)micInfo.sample_rate) {
+        micInfo.sample_rate = capture_rate;
+        mic_config.sample_rate = capture_rate;
+        micIn.end();
+        micIn.begin(mic_config);
+        update_i2s_memory(nullptr, &mic_config);
+    }
+
+    micDecimator.begin(capture_rate, rate);
+    recordInfo.sample_rate = rate;
+
+    return true;
+}
+
+uint32_t get_mic_rate() { return recordInfo.sample_rate; }
+
+void set_recording_gain(uint8_t new_gain) { micGain.set_gain(new_gain); }
+
+int16_t get_mic_level() {
+    // While recording or monitoring, report the loudest sample since the last call rather than
+    // taking samples away from the task that is using the mic
+    if (recording_audio || monitoring) {
+        int16_t level = mic_peak;
+        mic_peak = 0;
+        return level;
+    }
+
+    int16_t block[MIC_LEVEL_SAMPLES];
+    size_t bytes = micIn.readBytes((uint8_t *)block, sizeof(block));
+    return peak_level(block, bytes / sizeof(int16_t));
+}
 
 I2SStream &get_speaker_stream() { return speakerOut; }
 
@@ -172,8 +515,8 @@ I2SStream &get_mic_stream() { return micIn; }
 
 bool add_notes(const std::string &new_notes) {
     if ((notes.length() + new_notes.length()) > MAX_NOTES_IN_BUFFER) {
-        Serial.printf("Error adding notes: too many notes in buffer (%d + %d > %d).\n",
-                      new_notes.length(), notes.length(), MAX_NOTES_IN_BUFFER);
+        YLOG_ERROR("Error adding notes: too many notes in buffer (%d + %d > %d).",
+                   new_notes.length(), notes.length(), MAX_NOTES_IN_BUFFER);
         return false;
     }
 
@@ -189,54 +532,231 @@ bool add_notes(const std::string &new_notes) {
     return true;
 }
 
+bool play_song(const Song &song) {
+    // Whether notes or wave is running, stop it
+    stop_speaker();
+
+    xSemaphoreTake(notes_mutex, portMAX_DELAY);
+    song_events = song.events;
+    song_length = song.length;
+    song_position = 0;
+    xSemaphoreGive(notes_mutex);
+
+    // Signal we need to play the notes
+    playing_tones = true;
+    xTaskNotifyGive(play_speaker_task_handle);
+
+    return true;
+}
+
+bool play_song_file(const std::string &filename) {
+    // Whether notes or wave is running, stop it
+    stop_speaker();
+
+    File file = SD.open(filename.c_str());
+    if (!file) {
+        YLOG_ERROR("Error opening file: %s", filename.c_str());
+        return false;
+    }
+
+    uint8_t header[song_file_header_size];
+    uint32_t event_count;
+    if (file.read(header, sizeof(header)) != sizeof(header) ||
+        !decode_song_header(header, event_count)) {
+        YLOG_ERROR("Not a song file: %s", filename.c_str());
+        file.close();
+        return false;
+    }
+
+    // Events are read a few at a time as they are played
+    xSemaphoreTake(notes_mutex, portMAX_DELAY);
+    song_file = file;
+    song_file_remaining = event_count;
+    song_file_buffered = 0;
+    song_file_next = 0;
+    xSemaphoreGive(notes_mutex);
+
+    // Signal we need to play the notes
+    playing_tones = true;
+    xTaskNotifyGive(play_speaker_task_handle);
+
+    return true;
+}
+
 void stop_speaker() {
     // Update flags
     playing_tones = false;
     playing_file = false;
+    loop_playback = false;
+    monitoring = false;
 
     // Clear out all pending notes
     xSemaphoreTake(notes_mutex, portMAX_DELAY);
     notes.clear();
+    song_length = 0;
+    song_position = 0;
+    close_song_file();
     xSemaphoreGive(notes_mutex);
-
-    copier.end();
 }
 
 bool is_playing() { return playing_tones || playing_file; }
 
-bool play_sound_file(const std::string &filename) {
+bool start_monitor() {
+    if (recording_audio) {
+        YLOG_ERROR("Can't monitor the microphone while recording");
+        return false;
+    }
+
     // Whether notes or wave is running, stop it
     stop_speaker();
 
-    sound_file = SD.open(filename.c_str());
-    if (!sound_file) {
-        Serial.printf("Error opening file: %s\n", filename.c_str());
+    // Signal the speaker task to start passing the mic through
+    monitoring = true;
+    xTaskNotifyGive(play_speaker_task_handle);
+
+    return true;
+}
+
+bool is_monitoring() { return monitoring; }
+
+void set_monitor_volume(uint8_t volume) {
+    monitor_volume = volume;
+    if (monitoring) {
+        speakerGain.set_gain(monitor_volume);
+    }
+}
+
+VoiceEffects &get_voice_effects() { return voiceEffects; }
+
+uint32_t measure_monitor_latency() {
+    if (!monitoring) {
+        return 0;
+    }
+
+    latency_state = LATENCY_REQUESTED;
+    while (latency_state != LATENCY_DONE && monitoring) {
+        delay(10);
+    }
+
+    uint32_t result = latency_state == LATENCY_DONE ? latency_result_us : 0;
+    latency_state = LATENCY_IDLE;
+    return result;
+}
+
+bool play_sound_file(const std::string &filename, bool loop) {
+    return play_entry({filename, nullptr, 0, -1}, loop);
+}
+
+bool play_buffer(const uint8_t *data, size_t len, bool loop) {
+    if (!data || len == 0) {
         return false;
     }
+    return play_entry({"", data, len, -1}, loop);
+}
+
+// Looping belongs to the playlist, so a sound started after a looping one plays once
+bool play_entry(const playlist_entry_t &entry, bool loop) {
+    // Whether notes or wave is running, stop it
+    stop_speaker();
+
+    // The playback task releases the mutex between blocks
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    close_track(*current_track);
+    close_track(*next_track);
+    playlist.assign(1, entry);
+    playlist_index = 0;
+    loop_playback = loop;
+
+    // Start decoding from a clean state rather than continuing the previous file
+    if (mp3_decoder_active) {
+        mp3_decoder->end();
+        mp3_decoder_active = false;
+    }
 
-    char start[4];
-    sound_file.readBytes(start, 4);
-    sound_file.seek(0);
+    bool success = open_track(*current_track, entry);
+    if (success) {
+        start_track(*current_track);
+        playing_file = true;
+    }
+    xSemaphoreGive(playback_mutex);
 
-    if (start[0] == 0xFF || start[0] == 0xFE || strncmp("ID3", (const char *)start, 3) == 0) {
-        LOGI("using MP3DecoderHelix");
-        mp3_decoder.end();
-        mp3_decoder.begin();
-        copier.begin(mp3_decoder, sound_file);
-    } else if (strncmp("RIFF", (const char *)start, 4) == 0) {
-        LOGI("using WAVDecoder");
-        wav_decoder.end();
-        wav_decoder.begin();
-        copier.begin(wav_decoder, sound_file);
-    } else {
-        LOGE("Unknown file type");
+    if (success) {
+        xTaskNotifyGive(play_speaker_task_handle);
+    }
+
+    return success;
+}
+
+bool queue_sound_file(const std::string &filename) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    bool queued = playing_file && playlist.size() < MAX_PLAYLIST_LENGTH;
+    if (queued) {
+        playlist.push_back({filename, nullptr, 0, -1});
+    }
+    bool was_playing = playing_file;
+    xSemaphoreGive(playback_mutex);
+
+    // With nothing playing, start the new playlist right away
+    if (!was_playing) {
+        return play_sound_file(filename);
+    }
+
+    if (!queued) {
+        YLOG_ERROR("Error queueing %s: playlist is full.", filename.c_str());
+    }
+    return queued;
+}
+
+void set_loop(bool loop) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    loop_playback = loop;
+    xSemaphoreGive(playback_mutex);
+}
+
+bool open_sound_pack(const std::string &filename) {
+    // Sounds from the old pack may be playing from its file. Without one, whatever is playing
+    // doesn't depend on the pack and can carry on.
+    bool replacing = soundPack.is_open();
+    if (replacing) {
+        stop_speaker();
+    }
+
+    File file = SD.open(filename.c_str());
+    if (!file) {
         return false;
     }
 
-    playing_file = true;
-    xTaskNotifyGive(play_speaker_task_handle);
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    if (replacing) {
+        close_track(*current_track);
+        close_track(*next_track);
+    }
+    bool success = soundPack.open(file);
+    xSemaphoreGive(playback_mutex);
 
-    return true;
+    if (!success) {
+        file.close();
+        YLOG_ERROR("Invalid sound pack: %s", filename.c_str());
+    }
+    return success;
+}
+
+int find_pack_sound(const std::string &name) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    int id = soundPack.find(name.c_str());
+    xSemaphoreGive(playback_mutex);
+    return id;
+}
+
+bool play_pack_sound(int id, bool loop) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    bool valid = soundPack.get(id) != nullptr;
+    xSemaphoreGive(playback_mutex);
+
+    if (!valid) {
+        return false;
+    }
+    return play_entry({"", nullptr, 0, id}, loop);
 }
 
 ////////////////////////////// Private Functions ///////////////////////////////
@@ -247,6 +767,60 @@ void set_note_defaults() {
     volume_notes = 5;
 }
 
+bool next_note(note_t &note) {
+    bool available = true;
+    note_event_t event;
+
+    xSemaphoreTake(notes_mutex, portMAX_DELAY);
+    if (song_position < song_length) {
+        event = song_events[song_position++];
+        note = {event.frequency, event.duration, event.volume};
+    } else if (song_file_remaining && read_song_file_event(event)) {
+        note = {event.frequency, event.duration, event.volume};
+    } else if (notes.length()) {
+        note = parse_next_note();
+    } else {
+        available = false;
+    }
+    xSemaphoreGive(notes_mutex);
+
+    return available;
+}
+
+// Must be called with notes_mutex held
+bool read_song_file_event(note_event_t &event) {
+    if (song_file_next == song_file_buffered) {
+        size_t count = min((uint32_t)SONG_FILE_READ_AHEAD, song_file_remaining);
+        size_t bytes = song_file.read(song_file_buffer, count * song_file_event_size);
+
+        song_file_buffered = bytes / song_file_event_size;
+        song_file_next = 0;
+        if (song_file_buffered == 0) {
+            // The file is shorter than its header said
+            close_song_file();
+            return false;
+        }
+    }
+
+    event = decode_song_event(&song_file_buffer[song_file_next * song_file_event_size]);
+    song_file_next++;
+
+    if (--song_file_remaining == 0) {
+        close_song_file();
+    }
+
+    return true;
+}
+
+void close_song_file() {
+    song_file_remaining = 0;
+    song_file_buffered = 0;
+    song_file_next = 0;
+    if (song_file) {
+        song_file.close();
+    }
+}
+
 note_t parse_next_note() {
     static float note_freq;
     static float duration_s;
@@ -397,19 +971,640 @@ note_t parse_next_note() {
 
                 break;
             }
-            return {(unsigned int)round(note_freq), (unsigned int)(duration_s * 1000)};
+            return {(unsigned int)round(note_freq), (unsigned int)(duration_s * 1000),
+                    (unsigned int)volume_notes};
         }
 
         // If we reach here then we have a syntax error
-        Serial.printf("Syntax error in notes: %s\n", notes.c_str());
+        YLOG_ERROR("Syntax error in notes: %s", notes.c_str());
         notes.clear();
         break;
     }
 
-    return {0, 0};
+    return {0, 0, 0};
+}
+
+void set_wave_volume(uint8_t new_volume) {
+    wave_volume = new_volume / 10.0;
+    if (playing_file) {
+        speakerGain.set_gain(wave_volume);
+    }
+}
+
+void set_resample_quality(Resampler::Quality quality) {
+    // Rebuilding the filter frees the buffers the playback task resamples through
+    if (playback_mutex) {
+        xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    }
+    speakerFormat.set_quality(quality);
+    if (playback_mutex) {
+        xSemaphoreGive(playback_mutex);
+    }
+}
+
+void set_effects_filter(int index, FilterType type, float frequency, float q, float gain_db) {
+    // The playback task holds the mutex while it processes a block
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    speakerEffects.set_filter(index, type, frequency, q, gain_db);
+    xSemaphoreGive(playback_mutex);
+}
+
+void set_effects_limiter(float threshold_db, float lookahead_ms, float release_ms) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    speakerEffects.set_limiter(threshold_db, lookahead_ms, release_ms);
+    xSemaphoreGive(playback_mutex);
+}
+
+void set_effects_bypass(int stage, bool bypass) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    speakerEffects.set_bypass(stage, bypass);
+    xSemaphoreGive(playback_mutex);
+}
+
+float get_effects_cycles_per_sample(int stage) {
+    xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    float cycles = speakerEffects.get_cycles_per_sample(stage);
+    xSemaphoreGive(playback_mutex);
+    return cycles;
+}
+
+bool configure_memory(const memory_config_t &config) {
+    if (playing_file || recording_audio) {
+        YLOG_ERROR("Can't change audio memory while playing or recording a file");
+        return false;
+    }
+    if (config.file_block_bytes < MIN_FILE_BLOCK_BYTES) {
+        YLOG_ERROR("File blocks must be at least %u bytes", (unsigned)MIN_FILE_BLOCK_BYTES);
+        return false;
+    }
+
+    // Buffers of the old sizes are freed, and the new sizes are used when next allocated
+    if (playback_mutex) {
+        xSemaphoreTake(playback_mutex, portMAX_DELAY);
+    }
+    release_playback_memory();
+    memory_config = config;
+    if (playback_mutex) {
+        xSemaphoreGive(playback_mutex);
+    }
+    release_recording_memory();
+
+    return true;
 }
 
-void set_wave_volume(uint8_t new_volume) { speakerVolume.setVolume(new_volume / 10.0); }
+void release_memory() {
+    if (playback_mutex) {
+        xSemaphoreTake(playback_mutex, portMAX_DELAY);
+        if (!playing_file) {
+            release_playback_memory();
+        }
+        xSemaphoreGive(playback_mutex);
+    }
+
+    if (!recording_audio && done_recording_audio) {
+        release_recording_memory();
+    }
+}
+
+memory_usage_t get_memory_usage(memory_component_t component) {
+    if (component == MEMORY_EFFECTS) {
+        // Always allocated, as part of the program's static memory
+        size_t bytes = sizeof(speakerEffects) + sizeof(voiceEffects) + sizeof(monitorResampler) +
+                       sizeof(micDecimator) + sizeof(speakerFormat);
+        return {bytes, bytes};
+    }
+    if (component < 0 || component >= MEMORY_COMPONENT_COUNT) {
+        return {0, 0};
+    }
+    return memory_usage[component];
+}
+
+bool open_track(track_t &track, const playlist_entry_t &entry) {
+    const char *name = entry.data ? "sound in memory" : entry.filename.c_str();
+    const pack_entry_t *pack_entry = soundPack.get(entry.pack_id);
+
+    track.base = 0;
+    if (entry.data) {
+        track.memory = entry.data;
+        track.size = entry.size;
+    } else if (pack_entry) {
+        // Every sound in the pack shares its file, which is seeked as needed
+        name = "sound in pack";
+        track.file = soundPack.get_file();
+        track.shared_file = true;
+        track.base = pack_entry->offset;
+        track.size = pack_entry->length;
+    } else {
+        track.file = SD.open(entry.filename.c_str());
+        if (!track.file) {
+            YLOG_ERROR("Error opening file: %s", name);
+            return false;
+        }
+        track.size = track.file.size();
+    }
+
+    if (track.file && !allocate_file_buffers()) {
+        YLOG_ERROR("Not enough memory for the sound file buffers");
+        close_track(track);
+        return false;
+    }
+
+    uint8_t start[4] = {0};
+    read_track_at(track, 0, start, sizeof(start));
+
+    if (start[0] == 0xFF || start[0] == 0xFE || strncmp("ID3", (const char *)start, 3) == 0) {
+        track.format = FORMAT_MP3;
+        track.data_start = 0;
+        track.data_end = track.size;
+        track.loop_start = 0;
+        track.loop_end = 0;
+    } else if (strncmp("RIFF", (const char *)start, 4) == 0) {
+        if (!parse_wav_header(track)) {
+            YLOG_ERROR("Unsupported WAV file: %s", name);
+            close_track(track);
+            return false;
+        }
+    } else {
+        YLOG_ERROR("Unknown file type");
+        close_track(track);
+        return false;
+    }
+
+    bool allocated = true;
+    if (track.format == FORMAT_MP3) {
+        allocated = create_mp3_decoder();
+    } else if (track.format == FORMAT_WAV_ADPCM) {
+        allocated = allocate_adpcm_buffer();
+    }
+    if (!allocated) {
+        YLOG_ERROR("Not enough memory to decode %s", name);
+        close_track(track);
+        return false;
+    }
+
+    track.position = track.data_start;
+
+    // Read the start of the audio now, so it can begin playing without waiting on the card.
+    // Sounds in memory are read in place instead.
+    track.prefetch_len = 0;
+    if (track.file && track.prefetch) {
+        uint32_t len = min((uint32_t)memory_config.prefetch_bytes,
+                           track.data_end - track.data_start);
+        if (track.format == FORMAT_WAV_ADPCM) {
+            len -= len % track.block_align;
+        }
+        track.prefetch_len = read_track_at(track, track.data_start, track.prefetch, len);
+    }
+
+    return true;
+}
+
+size_t read_track_at(track_t &track, uint32_t offset, uint8_t *data, size_t len) {
+    if (offset >= track.size) {
+        return 0;
+    }
+    len = min(len, (size_t)(track.size - offset));
+
+    if (track.memory) {
+        memcpy(data, track.memory + offset, len);
+        return len;
+    }
+
+    if (track.file.position() != track.base + offset) {
+        track.file.seek(track.base + offset);
+    }
+    return track.file.read(data, len);
+}
+
+bool parse_wav_header(track_t &track) {
+    uint8_t header[12];
+    if (read_track_at(track, 0, header, sizeof(header)) != sizeof(header) ||
+        strncmp("WAVE", (const char *)header + 8, 4) != 0) {
+        return false;
+    }
+
+    bool have_format = false;
+    bool have_data = false;
+    uint16_t block_align = 0;
+    uint32_t loop_first = 0;
+    uint32_t loop_last = 0;
+    bool have_loop = false;
+    uint32_t fact_frames = UINT32_MAX;
+    uint32_t size = track.size;
+    uint32_t offset = sizeof(header);
+
+    while (offset + 8 <= size) {
+        uint8_t chunk[8];
+        if (read_track_at(track, offset, chunk, sizeof(chunk)) != sizeof(chunk)) {
+            break;
+        }
+        uint32_t chunk_size = read_le32(chunk + 4);
+        uint32_t body = offset + sizeof(chunk);
+
+        if (strncmp("fmt ", (const char *)chunk, 4) == 0 && chunk_size >= 16) {
+            uint8_t fmt[16];
+            read_track_at(track, body, fmt, sizeof(fmt));
+            uint16_t format_tag = read_le16(fmt);
+            track.info = AudioInfo(read_le32(fmt + 4), read_le16(fmt + 2), read_le16(fmt + 14));
+            block_align = read_le16(fmt + 12);
+            if (format_tag == ima_adpcm_format_tag) {
+                // Decoded to 16-bit a block at a time
+                track.format = FORMAT_WAV_ADPCM;
+                have_format = track.info.bits_per_sample == 4 && track.info.channels >= 1 &&
+                              track.info.channels <= 2 &&
+                              block_align <= memory_config.file_block_bytes &&
+                              block_align > 4 * track.info.channels;
+                track.info.bits_per_sample = 16;
+            } else {
+                // Plain PCM, or WAVE_FORMAT_EXTENSIBLE (which is PCM for the files we accept)
+                track.format = FORMAT_WAV;
+                have_format = (format_tag == 1 || format_tag == 0xFFFE);
+            }
+        } else if (strncmp("data", (const char *)chunk, 4) == 0) {
+            track.data_start = body;
+            track.data_end = body + min(chunk_size, size - body);
+            have_data = true;
+        } else if (strncmp("fact", (const char *)chunk, 4) == 0 && chunk_size >= 4) {
+            uint8_t fact[4];
+            if (read_track_at(track, body, fact, sizeof(fact)) == sizeof(fact)) {
+                fact_frames = read_le32(fact);
+            }
+        } else if (strncmp("smpl", (const char *)chunk, 4) == 0 && chunk_size >= 60) {
+            // The sampler chunk has a 36 byte header followed by 24 byte loop records
+            uint8_t smpl[60];
+            read_track_at(track, body, smpl, sizeof(smpl));
+            if (read_le32(smpl + 28) > 0) {
+                loop_first = read_le32(smpl + 36 + 8);
+                loop_last = read_le32(smpl + 36 + 12);
+                have_loop = true;
+            }
+        }
+
+        // A chunk running past the end of the file is only usable if it is the sound itself,
+        // which some recorders leave unfinished. Anything after it can't be found.
+        if (chunk_size > size - body) {
+            if (track.data_start == body) {
+                break;
+            }
+            YLOG_ERROR("Bad chunk size in WAV file");
+            return false;
+        }
+
+        // Chunks are padded to an even length
+        offset = body + chunk_size + (chunk_size & 1);
+    }
+
+    if (!have_format || !have_data || track.info.bits_per_sample != 16 || block_align == 0) {
+        return false;
+    }
+
+    track.block_align = block_align;
+    track.frame_count = track.format == FORMAT_WAV_ADPCM ? fact_frames : UINT32_MAX;
+    track.loop_start = 0;
+    track.loop_end = 0;
+    if (have_loop && track.format == FORMAT_WAV) {
+        // Loop points are in frames, and the end frame is played
+        uint32_t loop_start = track.data_start + loop_first * block_align;
+        uint32_t loop_end = min(track.data_start + (loop_last + 1) * block_align, track.data_end);
+        if (loop_start < loop_end) {
+            track.loop_start = loop_start;
+            track.loop_end = loop_end;
+        }
+    }
+
+    return true;
+}
+
+bool is_track_open(const track_t &track) { return track.memory || track.file; }
+
+void close_track(track_t &track) {
+    if (track.shared_file) {
+        // Let go of the sound pack without closing it
+        track.file = File();
+        track.shared_file = false;
+    } else if (track.file) {
+        track.file.close();
+    }
+    track.memory = nullptr;
+    track.prefetch_len = 0;
+    if (&track == next_track) {
+        next_track_index = -1;
+    }
+}
+
+// Sets up the decoding pipeline for a track, keeping the MP3 decoder running across MP3 tracks
+// so that one frame follows the next without a reset
+void start_track(track_t &track) {
+    if (track.format == FORMAT_MP3) {
+        speakerFormat.set_source(mp3_codec);
+        if (!mp3_decoder_active) {
+            size_t free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+            mp3_decoder->begin();
+            mp3_decoder_active = true;
+
+            // Only the first start allocates, unless ending the decoder freed its buffers
+            mp3_begin_bytes = max(mp3_begin_bytes, heap_used_since(free_before));
+            set_memory_usage(MEMORY_MP3_DECODER, mp3_created_bytes + mp3_begin_bytes);
+        }
+    } else {
+        if (mp3_decoder_active) {
+            mp3_decoder->end();
+            mp3_decoder_active = false;
+        }
+        speakerFormat.set_source(nullptr);
+        speakerFormat.setAudioInfo(track.info);
+    }
+}
+
+// Points data at the next len bytes or less of the track. Sounds in memory and the prefetched
+// start of a file are used in place, and the rest of a file is read into file_block.
+size_t read_track(track_t &track, size_t len, const uint8_t *&data) {
+    // Loop points only apply while looping, otherwise the whole file plays through
+    bool use_loop = loop_playback && track.loop_end;
+    uint32_t end = use_loop ? track.loop_end : track.data_end;
+
+    if (track.position >= end) {
+        if (!use_loop) {
+            return 0;
+        }
+        track.position = track.loop_start;
+    }
+
+    size_t count = min((uint32_t)len, end - track.position);
+    uint32_t offset = track.position - track.data_start;
+
+    // ADPCM is decoded a whole block at a time
+    if (track.format == FORMAT_WAV_ADPCM && count > track.block_align) {
+        count -= count % track.block_align;
+    }
+
+    if (track.memory) {
+        data = track.memory + track.position;
+    } else if (offset < track.prefetch_len) {
+        count = min(count, (size_t)(track.prefetch_len - offset));
+        data = track.prefetch + offset;
+    } else {
+        count = read_track_at(track, track.position, file_block, count);
+        if (count == 0) {
+            // The file is shorter than its header said
+            track.position = track.data_end;
+            return 0;
+        }
+        data = file_block;
+    }
+
+    track.position += count;
+    return count;
+}
+
+void write_track(track_t &track, const uint8_t *data, size_t len) {
+    if (track.format == FORMAT_MP3) {
+        mp3_decoder->write(data, len);
+    } else if (track.format == FORMAT_WAV_ADPCM) {
+        // The data ends where the track is now, which gives the frame each block starts at
+        size_t frames_per_block =
+            ima_adpcm_frames_per_block(track.block_align, track.info.channels);
+        uint32_t block_index = (track.position - len - track.data_start) / track.block_align;
+
+        for (size_t offset = 0; offset < len; offset += track.block_align, block_index++) {
+            uint32_t first_frame = block_index * frames_per_block;
+            if (first_frame >= track.frame_count) {
+                break;
+            }
+            size_t block_len = min((size_t)track.block_align, len - offset);
+            size_t frames = ima_adpcm_decode_block(data + offset, block_len, track.info.channels,
+                                                   adpcm_block);
+            frames = min(frames, (size_t)(track.frame_count - first_frame));
+            speakerFormat.write((const uint8_t *)adpcm_block,
+                                frames * track.info.channels * sizeof(int16_t));
+        }
+    } else {
+        speakerFormat.write(data, len);
+    }
+}
+
+int next_playlist_index() {
+    if (playlist_index + 1 < playlist.size()) {
+        return playlist_index + 1;
+    }
+    if (loop_playback && !playlist.empty()) {
+        return 0;
+    }
+    return -1;
+}
+
+// Opens the next file in the playlist while the current one is playing
+void prepare_next_track() {
+    int index = next_playlist_index();
+    if (index == next_track_index) {
+        return;
+    }
+
+    close_track(*next_track);
+    if (index < 0 || index == (int)playlist_index) {
+        return;
+    }
+
+    // Remember the index even if opening fails, so it isn't retried on every block
+    open_track(*next_track, playlist[index]);
+    next_track_index = index;
+}
+
+// Moves on to the next track once the current one has run out, returning false at the end
+bool advance_track() {
+    int index = next_playlist_index();
+    if (index < 0) {
+        return false;
+    }
+
+    // Looping a single file restarts it from the data already read ahead
+    if (index == (int)playlist_index) {
+        current_track->position = current_track->data_start;
+        return true;
+    }
+
+    prepare_next_track();
+    if (next_track_index != index || !is_track_open(*next_track)) {
+        return false;
+    }
+
+    close_track(*current_track);
+    std::swap(current_track, next_track);
+    next_track_index = -1;
+    playlist_index = index;
+    start_track(*current_track);
+
+    return true;
+}
+
+void *allocate_buffer(size_t bytes) {
+    void *buffer = nullptr;
+    if (memory_config.use_psram && psramFound()) {
+        buffer = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (!buffer) {
+        buffer = heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    return buffer;
+}
+
+void free_buffer(void *buffer) {
+    if (buffer) {
+        heap_caps_free(buffer);
+    }
+}
+
+void set_memory_usage(memory_component_t component, size_t bytes) {
+    memory_usage[component].current = bytes;
+    if (bytes > memory_usage[component].peak) {
+        memory_usage[component].peak = bytes;
+    }
+}
+
+// Internal RAM allocated since free_before was read. Other tasks allocating at the same time
+// are counted too, so this is approximate.
+size_t heap_used_since(size_t free_before) {
+    size_t free_now = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    return free_before > free_now ? free_before - free_now : 0;
+}
+
+// The I2S driver allocates its DMA buffers from the sizes in the config. Null leaves the
+// previous figure for that stream.
+void update_i2s_memory(const I2SConfig *speaker, const I2SConfig *mic) {
+    if (speaker) {
+        speaker_dma_bytes = speaker->buffer_count * speaker->buffer_size;
+    }
+    if (mic) {
+        mic_dma_bytes = mic->buffer_count * mic->buffer_size;
+    }
+    set_memory_usage(MEMORY_I2S_BUFFERS, speaker_dma_bytes + mic_dma_bytes);
+}
+
+// Must be called with playback_mutex held
+bool allocate_file_buffers() {
+    if (file_block) {
+        return true;
+    }
+
+    file_block = (uint8_t *)allocate_buffer(memory_config.file_block_bytes);
+    bool prefetch = memory_config.prefetch_bytes > 0;
+    for (int i = 0; i < 2 && prefetch; i++) {
+        tracks[i].prefetch = (uint8_t *)allocate_buffer(memory_config.prefetch_bytes);
+    }
+    if (!file_block || (prefetch && (!tracks[0].prefetch || !tracks[1].prefetch))) {
+        release_playback_memory();
+        return false;
+    }
+
+    set_memory_usage(MEMORY_FILE_BUFFERS,
+                     memory_config.file_block_bytes + 2 * memory_config.prefetch_bytes);
+    return true;
+}
+
+// Must be called with playback_mutex held. ADPCM decodes to at most 2 samples per byte.
+bool allocate_adpcm_buffer() {
+    if (adpcm_block) {
+        return true;
+    }
+
+    size_t bytes = 2 * memory_config.file_block_bytes * sizeof(int16_t);
+    adpcm_block = (int16_t *)allocate_buffer(bytes);
+    if (!adpcm_block) {
+        return false;
+    }
+
+    set_memory_usage(MEMORY_ADPCM_DECODER, bytes);
+    return true;
+}
+
+// Must be called with playback_mutex held. The Helix decoder allocates from internal RAM
+// itself, so its use is measured as the change in free heap.
+bool create_mp3_decoder() {
+    if (mp3_decoder) {
+        return true;
+    }
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    mp3_codec = new (std::nothrow) MP3DecoderHelix();
+    if (mp3_codec) {
+        mp3_decoder = new (std::nothrow) EncodedAudioStream(&speakerFormat, mp3_codec);
+    }
+    if (!mp3_decoder) {
+        delete mp3_codec;
+        mp3_codec = nullptr;
+        return false;
+    }
+    mp3_created_bytes = heap_used_since(free_before);
+    mp3_begin_bytes = 0;
+    set_memory_usage(MEMORY_MP3_DECODER, mp3_created_bytes);
+
+    return true;
+}
+
+// Must be called with playback_mutex held and no file playing
+void release_playback_memory() {
+    close_track(*current_track);
+    close_track(*next_track);
+
+    if (mp3_decoder) {
+        if (mp3_decoder_active) {
+            mp3_decoder->end();
+            mp3_decoder_active = false;
+        }
+        speakerFormat.set_source(nullptr);
+        delete mp3_decoder;
+        delete mp3_codec;
+        mp3_decoder = nullptr;
+        mp3_codec = nullptr;
+        set_memory_usage(MEMORY_MP3_DECODER, 0);
+    }
+
+    free_buffer(file_block);
+    file_block = nullptr;
+    for (int i = 0; i < 2; i++) {
+        free_buffer(tracks[i].prefetch);
+        tracks[i].prefetch = nullptr;
+    }
+    set_memory_usage(MEMORY_FILE_BUFFERS, 0);
+
+    free_buffer(adpcm_block);
+    adpcm_block = nullptr;
+    set_memory_usage(MEMORY_ADPCM_DECODER, 0);
+}
+
+// Must be called when not recording
+void release_recording_memory() {
+    delete wav_encoder;
+    delete wav_codec;
+    wav_encoder = nullptr;
+    wav_codec = nullptr;
+    set_memory_usage(MEMORY_WAV_ENCODER, 0);
+}
+
+uint32_t read_le32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+uint16_t read_le16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+
+void write_speaker(int16_t *samples, size_t count) {
+    speakerGain.process(samples, count);
+    speakerOut.write((const uint8_t *)samples, count * sizeof(int16_t));
+}
+
+int16_t peak_level(const int16_t *samples, size_t count) {
+    int32_t peak = 0;
+    for (size_t i = 0; i < count; i++) {
+        peak = max(peak, abs((int32_t)samples[i]));
+    }
+    return (int16_t)min(peak, (int32_t)INT16_MAX);
+}
+
+void fade_out_speaker() {
+    int16_t block[GAIN_RAMP_SAMPLES];
+    size_t count = speakerGain.fade_out(block, GAIN_RAMP_SAMPLES);
+    speakerOut.write((const uint8_t *)block, count * sizeof(int16_t));
+}
 
 void play_speaker_task(void *params) {
     while (1) {
@@ -417,40 +1612,163 @@ void play_speaker_task(void *params) {
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
         if (playing_tones) {
-            // Setup sine wave
-            sineWave.begin(sineInfo);
+            int16_t block[TONE_BLOCK_SAMPLES];
 
-            // Start the audio stream
-            copier.begin(speakerOut, toneStream);
+            // Setup sine wave. Volume is applied by the gain stage so it can be ramped.
+            sineWave.begin(sineInfo);
+            sineWave.setAmplitude(16000);
+            speakerGain.begin(GAIN_RAMP_SAMPLES);
 
             // Play all the notes until there are none left
-            while (notes.length()) {
-                xSemaphoreTake(notes_mutex, portMAX_DELAY);
-                note_t note = parse_next_note();
-                xSemaphoreGive(notes_mutex);
-
-                // Play the tone and wait for it to finish
+            note_t note;
+            while (next_note(note)) {
+                // Play the tone and wait for it to finish. Rests fade to silence rather than
+                // holding the sine wave at whatever level it stopped at.
                 sineWave.setFrequency(note.frequency);
-                sineWave.setAmplitude(16000 * (volume_notes / 10.0));
+                speakerGain.set_gain(note.frequency ? note.volume / 10.0 : 0);
 
                 // Copy during the note duration
                 int start_time = millis();
                 while ((millis() - start_time) < note.duration) {
-                    copier.copy(poppingRemover);
+                    size_t bytes = toneStream.readBytes((uint8_t *)block, sizeof(block));
+                    write_speaker(block, bytes / sizeof(int16_t));
                 }
             }
 
+            fade_out_speaker();
+
             // If all of the notes have been played, signal that we are done
             playing_tones = false;
         }
 
         if (playing_file) {
-            // Keep copying until the file and copier is done
-            while (playing_file &&
-                   !(copier.copy(poppingRemover) == 0 && sound_file.available() == 0))
-                ;
-            playing_file = false;
+            speakerGain.set_gain(wave_volume);
+            speakerGain.begin(GAIN_RAMP_SAMPLES);
+
+            // Keep playing blocks until the playlist is done or playback is stopped
+            while (playing_file) {
+                xSemaphoreTake(playback_mutex, portMAX_DELAY);
+                if (!playing_file) {
+                    // Stopped while waiting, and the tracks may have been released since
+                    xSemaphoreGive(playback_mutex);
+                    break;
+                }
+                const uint8_t *data;
+                size_t bytes = read_track(*current_track, memory_config.file_block_bytes, data);
+                if (bytes) {
+                    write_track(*current_track, data, bytes);
+                    prepare_next_track();
+                } else if (!advance_track()) {
+                    playing_file = false;
+                }
+                xSemaphoreGive(playback_mutex);
+            }
+
+            fade_out_speaker();
+
+            xSemaphoreTake(playback_mutex, portMAX_DELAY);
+            if (!playing_file) {
+                close_track(*current_track);
+                close_track(*next_track);
+                if (memory_config.release_when_idle) {
+                    release_playback_memory();
+                }
+            }
+            xSemaphoreGive(playback_mutex);
         }
+
+        if (monitoring) {
+            monitor_loop();
+        }
+    }
+}
+
+void monitor_loop() {
+    // Swap in short I2S queues for the duration of monitoring
+    I2SConfig config = speaker_config;
+    config.buffer_count = MONITOR_DMA_BUFFER_COUNT;
+    config.buffer_size = MONITOR_SPEAKER_DMA_BYTES;
+    speakerOut.end();
+    speakerOut.begin(config);
+
+    I2SConfig monitor_speaker_config = config;
+    config = mic_config;
+    config.buffer_count = MONITOR_DMA_BUFFER_COUNT;
+    config.buffer_size = MONITOR_MIC_DMA_BYTES;
+    micIn.end();
+    micIn.begin(config);
+    update_i2s_memory(&monitor_speaker_config, &config);
+
+    monitorResampler.begin(micInfo.sample_rate, sineInfo.sample_rate, Resampler::Quality::Balanced);
+    voiceEffects.begin(sineInfo.sample_rate);
+    speakerGain.set_gain(monitor_volume);
+    speakerGain.begin(GAIN_RAMP_SAMPLES);
+
+    int16_t in[MONITOR_BLOCK_SAMPLES];
+    int16_t out[MONITOR_BLOCK_SAMPLES];
+
+    while (monitoring) {
+        size_t count = micIn.readBytes((uint8_t *)in, sizeof(in)) / sizeof(int16_t);
+        int64_t read_time = esp_timer_get_time();
+
+        int16_t peak = peak_level(in, count);
+        if (peak > mic_peak) {
+            mic_peak = peak;
+        }
+
+        if (latency_state == LATENCY_REQUESTED) {
+            // Put a click in place of this block, so it takes the same path through the
+            // resampler, effects and gain as the voice would. The block arrived at read_time,
+            // and the click is heard when the block holding it arrives, so both ends include
+            // the time a block takes to come in from the microphone.
+            memset(in, 0, count * sizeof(int16_t));
+            for (int i = 0; i < LATENCY_CLICK_SAMPLES && i < (int)count; i++) {
+                in[i] = (i & 4) ? LATENCY_CLICK_LEVEL : -LATENCY_CLICK_LEVEL;
+            }
+            latency_click_time = read_time;
+            latency_threshold = max(peak * 4, LATENCY_MIN_THRESHOLD);
+            latency_state = LATENCY_LISTENING;
+        } else if (latency_state == LATENCY_LISTENING) {
+            check_latency_click(in, count, read_time);
+
+            // Keep the room out of the speaker so the click is the only thing to hear
+            memset(in, 0, count * sizeof(int16_t));
+        }
+
+        size_t offset = 0;
+        while (offset < count) {
+            size_t used;
+            size_t produced = monitorResampler.process(in + offset, count - offset, used, out,
+                                                       MONITOR_BLOCK_SAMPLES);
+            voiceEffects.process(out, produced);
+            write_speaker(out, produced);
+            offset += used;
+        }
+    }
+
+    fade_out_speaker();
+
+    // Return to the normal queue sizes, which are less likely to run dry during playback
+    speakerOut.end();
+    speakerOut.begin(speaker_config);
+    micIn.end();
+    micIn.begin(mic_config);
+    update_i2s_memory(&speaker_config, &mic_config);
+}
+
+void check_latency_click(const int16_t *samples, size_t count, int64_t read_time) {
+    for (size_t i = 0; i < count; i++) {
+        if (abs(samples[i]) >= latency_threshold) {
+            latency_result_us = read_time - latency_click_time;
+            latency_state = LATENCY_DONE;
+            return;
+        }
+    }
+
+    if (read_time - latency_click_time > LATENCY_TIMEOUT_US) {
+        // Never heard it, for example because the volume is too low
+        latency_result_us = 0;
+        latency_state = LATENCY_DONE;
     }
 }
 }; // namespace YAudio
@@ -1,34 +1,50 @@
 #include "yboard.h"
+#include "ylog.h"
 
 YBoardV3 Yboard;
 
-YBoardV3::YBoardV3() : strip(led_count, led_pin, NEO_GRB + NEO_KHZ800), display(128, 32) {}
+YBoardV3::YBoardV3()
+    : strip(led_count, led_pin, NEO_GRB + NEO_KHZ800),
+      // Keep the display driver from changing the bus clock around its own transfers
+      display(128, 32, &Wire, -1, i2c_frequency, i2c_frequency) {}
 
 YBoardV3::~YBoardV3() {}
 
 void YBoardV3::setup() {
+    // Start printing library messages before anything has a chance to report one
+    YLog::begin();
+    scheduler.set_flush([this]() { flush_outputs(); });
+
     setup_leds();
     setup_switches();
     setup_buttons();
 
     if (setup_sd_card()) {
-        Serial.println("SD Card Setup: Success");
+        YLOG_INFO("SD Card Setup: Success");
     }
 
     if (setup_speaker()) {
-        Serial.println("Speaker Setup: Success");
+        YLOG_INFO("Speaker Setup: Success");
+    }
+
+    if (setup_sound_pack()) {
+        YLOG_INFO("Sound Pack Setup: Success");
     }
 
     if (setup_mic()) {
-        Serial.println("Mic Setup: Success");
+        YLOG_INFO("Mic Setup: Success");
+    }
+
+    if (setup_i2c()) {
+        YLOG_INFO("I2C Setup: Success");
     }
 
     if (setup_accelerometer()) {
-        Serial.println("Accelerometer Setup: Success");
+        YLOG_INFO("Accelerometer Setup: Success");
     }
 
     if (setup_display()) {
-        Serial.println("Display Setup: Success");
+        YLOG_INFO("Display Setup: Success");
     }
 }
 
@@ -41,19 +57,27 @@ void YBoardV3::setup_leds() {
 
 void YBoardV3::set_led_color(uint16_t index, uint8_t red, uint8_t green, uint8_t blue) {
     strip.setPixelColor(index - 1, red, green, blue);
-    strip.show();
+    show_leds();
 }
 
 void YBoardV3::set_led_brightness(uint8_t brightness) {
     strip.setBrightness(brightness);
-    strip.show();
+    show_leds();
 }
 
 void YBoardV3::set_all_leds_color(uint8_t red, uint8_t green, uint8_t blue) {
     for (int i = 0; i < this->led_count; i++) {
         strip.setPixelColor(i, red, green, blue, false);
     }
-    strip.show();
+    show_leds();
+}
+
+void YBoardV3::show_leds() {
+    if (defer_flush) {
+        leds_dirty = true;
+    } else {
+        strip.show();
+    }
 }
 
 ////////////////////////////// Switches ///////////////////////////////
@@ -103,13 +127,22 @@ bool YBoardV3::setup_speaker() {
 
     if (!YAudio::setup_speaker(speaker_i2s_ws_pin, speaker_i2s_bclk_pin, speaker_i2s_data_pin,
                                speaker_i2s_port)) {
-        Serial.println("ERROR: Speaker setup failed.");
+        YLOG_ERROR("ERROR: Speaker setup failed.");
         return false;
     }
 
     return true;
 }
 
+bool YBoardV3::setup_sound_pack() {
+    // The pack is optional, so a missing one isn't an error
+    if (!sd_card_present || !SD.exists("/sounds.ypak")) {
+        return false;
+    }
+
+    return YAudio::open_sound_pack("/sounds.ypak");
+}
+
 bool YBoardV3::play_sound_file(const std::string &filename) {
     if (!play_sound_file_background(filename)) {
         return false;
@@ -122,7 +155,7 @@ bool YBoardV3::play_sound_file(const std::string &filename) {
     return true;
 }
 
-bool YBoardV3::play_sound_file_background(const std::string &filename) {
+bool YBoardV3::play_sound_file_background(const std::string &filename, bool loop) {
     // Prepend filename with a / if it doesn't have one
     std::string _filename = filename;
     if (_filename[0] != '/') {
@@ -130,20 +163,156 @@ bool YBoardV3::play_sound_file_background(const std::string &filename) {
     }
 
     if (!sd_card_present) {
-        Serial.println("ERROR: SD Card not present.");
+        YLOG_ERROR("ERROR: SD Card not present.");
         return false;
     }
 
     if (!SD.exists(_filename.c_str())) {
-        Serial.println("File does not exist.");
+        YLOG_ERROR("File does not exist.");
         return false;
     }
 
-    return YAudio::play_sound_file(_filename);
+    return YAudio::play_sound_file(_filename, loop);
 }
 
+bool YBoardV3::play_buffer(const uint8_t *data, size_t size) {
+    if (!play_buffer_background(data, size)) {
+        return false;
+    }
+
+    while (is_audio_playing()) {
+        delay(10);
+    }
+
+    return true;
+}
+
+bool YBoardV3::play_buffer_background(const uint8_t *data, size_t size, bool loop) {
+    return YAudio::play_buffer(data, size, loop);
+}
+
+bool YBoardV3::play_asset(const YAudio::sound_asset_t &asset) {
+    return play_buffer(asset.data, asset.size);
+}
+
+bool YBoardV3::play_asset_background(const YAudio::sound_asset_t &asset, bool loop) {
+    return play_buffer_background(asset.data, asset.size, loop);
+}
+
+bool YBoardV3::open_sound_pack(const std::string &filename) {
+    // Prepend filename with a / if it doesn't have one
+    std::string _filename = filename;
+    if (_filename[0] != '/') {
+        _filename.insert(0, "/");
+    }
+
+    if (!sd_card_present) {
+        YLOG_ERROR("ERROR: SD Card not present.");
+        return false;
+    }
+
+    if (!SD.exists(_filename.c_str())) {
+        YLOG_ERROR("File does not exist.");
+        return false;
+    }
+
+    return YAudio::open_sound_pack(_filename);
+}
+
+int YBoardV3::get_sound_pack_id(const std::string &name) { return YAudio::find_pack_sound(name); }
+
+bool YBoardV3::play_sound_pack(const std::string &name) {
+    return play_sound_pack(get_sound_pack_id(name));
+}
+
+bool YBoardV3::play_sound_pack(int id) {
+    if (!play_sound_pack_background(id)) {
+        return false;
+    }
+
+    while (is_audio_playing()) {
+        delay(10);
+    }
+
+    return true;
+}
+
+bool YBoardV3::play_sound_pack_background(const std::string &name, bool loop) {
+    return play_sound_pack_background(get_sound_pack_id(name), loop);
+}
+
+bool YBoardV3::play_sound_pack_background(int id, bool loop) {
+    if (id < 0) {
+        YLOG_ERROR("Sound is not in the sound pack.");
+        return false;
+    }
+
+    return YAudio::play_pack_sound(id, loop);
+}
+
+bool YBoardV3::queue_sound_file(const std::string &filename) {
+    // Prepend filename with a / if it doesn't have one
+    std::string _filename = filename;
+    if (_filename[0] != '/') {
+        _filename.insert(0, "/");
+    }
+
+    if (!sd_card_present) {
+        YLOG_ERROR("ERROR: SD Card not present.");
+        return false;
+    }
+
+    return YAudio::queue_sound_file(_filename);
+}
+
+void YBoardV3::set_sound_file_loop(bool loop) { YAudio::set_loop(loop); }
+
 void YBoardV3::set_sound_file_volume(uint8_t volume) { YAudio::set_wave_volume(volume); }
 
+void YBoardV3::set_sound_file_quality(YAudio::Resampler::Quality quality) {
+    YAudio::set_resample_quality(quality);
+}
+
+void YBoardV3::set_sound_file_filter(int index, YAudio::FilterType type, float frequency,
+                                     float q, float gain_db) {
+    YAudio::set_effects_filter(index, type, frequency, q, gain_db);
+}
+
+void YBoardV3::set_sound_file_limiter(bool enabled, float threshold_db) {
+    YAudio::set_effects_limiter(threshold_db, 1.5, 50);
+    YAudio::set_effects_bypass(YAudio::EffectsChain::limiter_stage, !enabled);
+}
+
+float YBoardV3::get_sound_file_effect_cycles(int stage) {
+    return YAudio::get_effects_cycles_per_sample(stage);
+}
+
+bool YBoardV3::set_audio_memory(size_t file_block_bytes, size_t prefetch_bytes, bool use_psram,
+                                bool release_when_idle) {
+    return YAudio::configure_memory(
+        {file_block_bytes, prefetch_bytes, use_psram, release_when_idle});
+}
+
+void YBoardV3::release_audio_memory() { YAudio::release_memory(); }
+
+YAudio::memory_usage_t YBoardV3::get_audio_memory(YAudio::memory_component_t component) {
+    return YAudio::get_memory_usage(component);
+}
+
+void YBoardV3::print_audio_memory() {
+    static const char *names[] = {"MP3 decoder", "ADPCM decoder", "WAV encoder",
+                                  "File buffers", "I2S buffers",   "Effects"};
+    static_assert(sizeof(names) / sizeof(names[0]) == YAudio::MEMORY_COMPONENT_COUNT,
+                  "Every memory component needs a name");
+
+    Serial.println("Audio memory (bytes now / peak):");
+    for (int i = 0; i < YAudio::MEMORY_COMPONENT_COUNT; i++) {
+        YAudio::memory_usage_t usage = get_audio_memory((YAudio::memory_component_t)i);
+        Serial.printf("  %-14s %7u / %7u\n", names[i], (unsigned)usage.current,
+                      (unsigned)usage.peak);
+    }
+}
+
 bool YBoardV3::play_notes(const std::string &notes) {
     if (!play_notes_background(notes)) {
         return false;
@@ -158,6 +327,47 @@ bool YBoardV3::play_notes(const std::string &notes) {
 
 bool YBoardV3::play_notes_background(const std::string &notes) { return YAudio::add_notes(notes); }
 
+bool YBoardV3::play_song(const YAudio::Song &song) {
+    if (!play_song_background(song)) {
+        return false;
+    }
+
+    while (is_audio_playing()) {
+        delay(10);
+    }
+
+    return true;
+}
+
+bool YBoardV3::play_song_background(const YAudio::Song &song) { return YAudio::play_song(song); }
+
+bool YBoardV3::play_song_file(const std::string &filename) {
+    if (!play_song_file_background(filename)) {
+        return false;
+    }
+
+    while (is_audio_playing()) {
+        delay(10);
+    }
+
+    return true;
+}
+
+bool YBoardV3::play_song_file_background(const std::string &filename) {
+    // Prepend filename with a / if it doesn't have one
+    std::string _filename = filename;
+    if (_filename[0] != '/') {
+        _filename.insert(0, "/");
+    }
+
+    if (!sd_card_present) {
+        YLOG_ERROR("ERROR: SD Card not present.");
+        return false;
+    }
+
+    return YAudio::play_song_file(_filename);
+}
+
 void YBoardV3::stop_audio() { YAudio::stop_speaker(); }
 
 bool YBoardV3::is_audio_playing() { return YAudio::is_playing(); }
@@ -167,7 +377,7 @@ I2SStream &YBoardV3::get_speaker_stream() { return YAudio::get_speaker_stream();
 ////////////////////////////// Microphone ////////////////////////////////////////
 bool YBoardV3::setup_mic() {
     if (!YAudio::setup_mic(mic_i2s_ws_pin, mic_i2s_data_pin, mic_i2s_port)) {
-        Serial.println("ERROR: Mic setup failed.");
+        YLOG_ERROR("ERROR: Mic setup failed.");
         return false;
     }
 
@@ -184,7 +394,7 @@ bool YBoardV3::start_recording(const std::string &filename) {
     }
 
     if (!sd_card_present) {
-        Serial.println("ERROR: SD Card not present.");
+        YLOG_ERROR("ERROR: SD Card not present.");
         return false;
     }
 
@@ -197,33 +407,170 @@ bool YBoardV3::is_recording() { return YAudio::is_recording(); }
 
 void YBoardV3::set_recording_volume(uint8_t volume) { YAudio::set_recording_gain(volume); }
 
+bool YBoardV3::set_recording_rate(uint32_t rate) { return YAudio::set_mic_rate(rate); }
+
 I2SStream &YBoardV3::get_microphone_stream() { return YAudio::get_mic_stream(); }
 
-////////////////////////////// Accelerometer /////////////////////////////////////
-bool YBoardV3::setup_accelerometer() {
-    if (!wire_begin) {
-        Wire.begin(sda_pin, scl_pin);
-        wire_begin = true;
+bool YBoardV3::start_monitoring() { return YAudio::start_monitor(); }
+
+void YBoardV3::stop_monitoring() {
+    if (YAudio::is_monitoring()) {
+        YAudio::stop_speaker();
     }
+}
+
+bool YBoardV3::is_monitoring() { return YAudio::is_monitoring(); }
 
-    if (!accel.begin(accel_addr, Wire)) {
-        Serial.println("WARNING: Accelerometer not detected.");
+void YBoardV3::set_monitor_volume(uint8_t volume) { YAudio::set_monitor_volume(volume); }
+
+void YBoardV3::set_voice_pitch(int semitones) {
+    YAudio::get_voice_effects().set_pitch(powf(2, semitones / 12.0f));
+}
+
+void YBoardV3::set_robot_voice(uint16_t frequency) {
+    YAudio::get_voice_effects().set_robot(frequency);
+}
+
+void YBoardV3::set_voice_echo(uint16_t delay_ms, uint8_t amount) {
+    YAudio::get_voice_effects().set_echo(delay_ms, min((int)amount, 9) / 10.0f);
+}
+
+float YBoardV3::measure_monitor_latency() { return YAudio::measure_monitor_latency() / 1000.0f; }
+
+////////////////////////////// I2C /////////////////////////////////////////////
+bool YBoardV3::setup_i2c() {
+    if (!i2c.begin(sda_pin, scl_pin, i2c_frequency)) {
+        YLOG_ERROR("ERROR: I2C setup failed.");
         return false;
     }
 
     return true;
 }
 
-bool YBoardV3::accelerometer_available() { return accel.available(); }
+////////////////////////////// Accelerometer /////////////////////////////////////
+bool YBoardV3::setup_accelerometer() {
+    if (!i2c.run(accel_addr, [this]() { return accel.begin(accel_addr, i2c.wire()); })) {
+        YLOG_WARNING("WARNING: Accelerometer not detected.");
+        return false;
+    }
+
+    return true;
+}
+
+// Runs the accelerometer at least twice as fast as anything samples it. At the same rate, its
+// clock and the sampling timer drift past each other and some reads would find nothing new.
+void YBoardV3::update_accelerometer_rate() {
+    uint32_t rate = 2 * max(data_log_accel_rate, orientation_rate);
+    if (rate == 0) {
+        return;
+    }
+
+    // The fastest rate is 1344Hz in the normal and high resolution modes
+    uint8_t data_rate = rate <= 10    ? LIS2DH12_ODR_10Hz
+                        : rate <= 25  ? LIS2DH12_ODR_25Hz
+                        : rate <= 50  ? LIS2DH12_ODR_50Hz
+                        : rate <= 100 ? LIS2DH12_ODR_100Hz
+                        : rate <= 200 ? LIS2DH12_ODR_200Hz
+                        : rate <= 400 ? LIS2DH12_ODR_400Hz
+                                      : LIS2DH12_ODR_5kHz376_LP_1kHz344_NM_HP;
+    i2c.run(accel_addr, [this, data_rate]() {
+        accel.setDataRate(data_rate);
+        return true;
+    });
+}
+
+// The driver's getX() waits for a new reading when there isn't one yet, which would hold up
+// every other device on the bus. The accelerometer has one flag for a new reading, so the
+// reading is kept for the other reader, and each gets a reading it hasn't had before or false.
+bool YBoardV3::read_new_acceleration(int16_t values[3], uint32_t &last_sequence) {
+    bool fresh = false;
+    i2c.run(accel_addr, [this, values, &last_sequence, &fresh]() {
+        if (accel.available()) {
+            accel_reading[0] = (int16_t)accel.getX();
+            accel_reading[1] = (int16_t)accel.getY();
+            accel_reading[2] = (int16_t)accel.getZ();
+            accel_sequence++;
+        }
+
+        fresh = accel_sequence != last_sequence;
+        if (fresh) {
+            memcpy(values, accel_reading, sizeof(accel_reading));
+            last_sequence = accel_sequence;
+        }
+        return true;
+    });
+    return fresh;
+}
+
+bool YBoardV3::accelerometer_available() {
+    return i2c.run(accel_addr, [this]() { return accel.available(); });
+}
 
 accelerometer_data YBoardV3::get_accelerometer() {
     accelerometer_data data;
-    data.x = accel.getX();
-    data.y = accel.getY();
-    data.z = accel.getZ();
+    i2c.run(accel_addr, [this, &data]() {
+        data.x = accel.getX();
+        data.y = accel.getY();
+        data.z = accel.getZ();
+
+        // This may have taken a reading the data log or orientation was waiting for
+        accel_reading[0] = (int16_t)data.x;
+        accel_reading[1] = (int16_t)data.y;
+        accel_reading[2] = (int16_t)data.z;
+        accel_sequence++;
+        return true;
+    });
+    return data;
+}
+
+bool YBoardV3::start_orientation(uint16_t rate_hz, float smoothing_hz) {
+    if (orientation.is_running()) {
+        YLOG_ERROR("Orientation is already running");
+        return false;
+    }
+
+    if (rate_hz > max_accel_rate) {
+        YLOG_ERROR("The accelerometer can't be read more than %u times a second",
+                   (unsigned)max_accel_rate);
+        return false;
+    }
+
+    // Readings from before it started aren't new to it
+    orientation_accel_sequence = accel_sequence;
+    if (!orientation.start(rate_hz, smoothing_hz, sample_orientation, this)) {
+        YLOG_ERROR("Error starting orientation.");
+        return false;
+    }
+
+    orientation_rate = rate_hz;
+    update_accelerometer_rate();
+    return true;
+}
+
+void YBoardV3::stop_orientation() {
+    orientation.stop();
+    orientation_rate = 0;
+}
+
+orientation_data YBoardV3::get_orientation() {
+    YOrientation::estimate_t estimate = orientation.get();
+
+    orientation_data data;
+    data.pitch = estimate.pitch * 0.01f;
+    data.roll = estimate.roll * 0.01f;
+    data.tilt = estimate.tilt * 0.01f;
+    data.timestamp_us = estimate.timestamp_us;
+    data.valid = estimate.sequence != 0;
     return data;
 }
 
+YOrientation::estimate_t YBoardV3::get_orientation_estimate() { return orientation.get(); }
+
+bool YBoardV3::sample_orientation(int16_t values[3], void *context) {
+    YBoardV3 *board = static_cast<YBoardV3 *>(context);
+    return board->read_new_acceleration(values, board->orientation_accel_sequence);
+}
+
 bool YBoardV3::setup_sd_card() {
     // Set microSD Card CS as OUTPUT and set HIGH
     pinMode(sd_cs_pin, OUTPUT);
@@ -234,7 +581,7 @@ bool YBoardV3::setup_sd_card() {
 
     // Start microSD Card
     if (!SD.begin(sd_cs_pin)) {
-        Serial.println("Error accessing microSD card!");
+        YLOG_ERROR("Error accessing microSD card!");
         sd_card_present = false;
         return false;
     }
@@ -244,9 +591,88 @@ bool YBoardV3::setup_sd_card() {
     return true;
 }
 
+////////////////////////////// Data Logging /////////////////////////////////////
+bool YBoardV3::start_data_log(const std::string &filename, const YDataLog::config_t &config) {
+    // Prepend filename with a / if it doesn't have one
+    std::string _filename = filename;
+    if (_filename[0] != '/') {
+        _filename.insert(0, "/");
+    }
+
+    if (!sd_card_present) {
+        YLOG_ERROR("ERROR: SD Card not present.");
+        return false;
+    }
+
+    if (data_logger.is_running()) {
+        YLOG_ERROR("Already logging data");
+        return false;
+    }
+
+    if (config.rate_hz[YDataLog::CHANNEL_ACCELEROMETER] > max_accel_rate) {
+        YLOG_ERROR("The accelerometer can't be read more than %u times a second",
+                   (unsigned)max_accel_rate);
+        return false;
+    }
+
+    data_log_accel_rate = config.rate_hz[YDataLog::CHANNEL_ACCELEROMETER];
+    update_accelerometer_rate();
+
+    File file = SD.open(_filename.c_str(), FILE_WRITE);
+    if (!file) {
+        YLOG_ERROR("Error opening/creating file for data log.");
+        return false;
+    }
+
+    data_log_accel_sequence = accel_sequence;
+    if (!data_logger.start(file, config, sample_data_log, this)) {
+        YLOG_ERROR("Error starting data log. Each rate must divide the fastest one evenly.");
+        file.close();
+        return false;
+    }
+
+    return true;
+}
+
+void YBoardV3::stop_data_log() {
+    data_logger.stop();
+    data_log_accel_rate = 0;
+}
+
+bool YBoardV3::is_data_logging() { return data_logger.is_running(); }
+
+YDataLog::stats_t YBoardV3::get_data_log_stats() { return data_logger.get_stats(); }
+
+bool YBoardV3::sample_data_log(YDataLog::channel_t channel, int16_t values[3], void *context) {
+    YBoardV3 *board = static_cast<YBoardV3 *>(context);
+
+    switch (channel) {
+    case YDataLog::CHANNEL_ACCELEROMETER:
+        return board->read_new_acceleration(values, board->data_log_accel_sequence);
+    case YDataLog::CHANNEL_KNOB:
+        values[0] = board->get_knob();
+        values[1] = analogRead(knob_pin);
+        return true;
+    case YDataLog::CHANNEL_BUTTONS:
+        values[0] = board->get_button(1) | (board->get_button(2) << 1) |
+                    (board->get_switch(1) << 2) | (board->get_switch(2) << 3);
+        return true;
+    case YDataLog::CHANNEL_MIC_LEVEL:
+        values[0] = YAudio::get_mic_level();
+        return true;
+    default:
+        return false;
+    }
+}
+
+////////////////////////////// Display /////////////////////////////////////////
 bool YBoardV3::setup_display() {
-    if (!display.begin(SSD1306_SWITCHCAPVCC, 0x3c)) {
-        Serial.println("Error initializing display");
+    // The bus is already started, so don't let the driver begin it again
+    auto begin_display = [this]() {
+        return display.begin(SSD1306_SWITCHCAPVCC, display_addr, true, false);
+    };
+    if (!i2c.run(display_addr, begin_display, YI2C::Priority::Low)) {
+        YLOG_ERROR("Error initializing display");
         return false;
     }
 
@@ -255,7 +681,108 @@ bool YBoardV3::setup_display() {
     display.setRotation(0);
     display.setTextWrap(false);
     display.setCursor(0, 0);
-    display.display();
+    update_display();
+
+    return true;
+}
+
+void YBoardV3::update_display() {
+    if (defer_flush) {
+        display_dirty = true;
+    } else {
+        send_display();
+    }
+}
 
+void YBoardV3::send_display() {
+    // Address the whole screen, then stream the buffer. This matches Adafruit_SSD1306::display()
+    // but lets the bus service accelerometer reads between chunks.
+    const uint8_t window[] = {0x00, // Command stream
+                              SSD1306_PAGEADDR,
+                              0,
+                              0xFF,
+                              SSD1306_COLUMNADDR,
+                              0,
+                              (uint8_t)(display.width() - 1)};
+    const size_t chunk_size = 32;
+
+    i2c.write(display_addr, window, sizeof(window), YI2C::Priority::Low);
+    i2c.write_bulk(display_addr, 0x40, display.getBuffer(), display.width() * display.height() / 8,
+                   chunk_size);
+
+    if (display_mirror.is_running()) {
+        display_mirror.send(display.getBuffer());
+    }
+}
+
+bool YBoardV3::set_display_mirror(bool enabled) {
+    if (!enabled) {
+        display_mirror.end();
+        return true;
+    }
+    if (display_mirror.is_running()) {
+        return true;
+    }
+    if (!display_mirror.begin(display.width(), display.height() / 8)) {
+        YLOG_ERROR("ERROR: Display mirror could not be started");
+        return false;
+    }
+
+    // Send the screen as it is now, rather than waiting for the next update
+    display_mirror.send(display.getBuffer());
     return true;
 }
+
+bool YBoardV3::is_display_mirroring() { return display_mirror.is_running(); }
+
+////////////////////////////// Scheduler /////////////////////////////////////////
+int YBoardV3::schedule(const char *name, float rate_hz, const std::function<void()> &callback,
+                       uint32_t budget_us) {
+    return scheduler.add(name, rate_hz, callback, budget_us);
+}
+
+void YBoardV3::run_scheduler() {
+    while (true) {
+        run_scheduler_once();
+    }
+}
+
+void YBoardV3::run_scheduler_once() {
+    defer_flush = true;
+    scheduler.run_once();
+    defer_flush = false;
+}
+
+bool YBoardV3::get_scheduler_stats(int id, YScheduler::stats_t &stats) {
+    return scheduler.get_stats(id, stats);
+}
+
+void YBoardV3::print_scheduler_stats() {
+    Serial.println("Scheduler (times in us): runs, average/max/budget, overruns, missed, "
+                   "average/max jitter");
+    for (int i = 0; i < scheduler.size(); i++) {
+        YScheduler::stats_t stats;
+        scheduler.get_stats(i, stats);
+        Serial.printf("  %-10s %7u %6u %6u %6u %5u %5u %6u %6u\n", scheduler.get_name(i),
+                      (unsigned)stats.runs, (unsigned)stats.average_us, (unsigned)stats.max_us,
+                      (unsigned)scheduler.get_budget(i), (unsigned)stats.overruns,
+                      (unsigned)stats.missed, (unsigned)stats.average_jitter_us,
+                      (unsigned)stats.max_jitter_us);
+    }
+
+    YScheduler::stats_t flush = scheduler.get_flush_stats();
+    Serial.printf("  %-10s %7u %6u %6u\n", "(flush)", (unsigned)flush.runs,
+                  (unsigned)flush.average_us, (unsigned)flush.max_us);
+}
+
+// Sends whatever the scheduled functions changed during the tick
+void YBoardV3::flush_outputs() {
+    if (leds_dirty) {
+        leds_dirty = false;
+        strip.show();
+    }
+    if (display_dirty) {
+        display_dirty = false;
+        send_display();
+    }
+}
@@ -0,0 +1,224 @@
+#include "ydatalog.h"
+
+namespace YDataLog {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Sent to the writer task in place of a block index to tell it to finish
+static const uint8_t STOP_WRITER = 0xFF;
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool Logger::start(File &log_file, const config_t &config, sample_cb_t sample_cb,
+                   void *context) {
+    if (running || !done) {
+        return false;
+    }
+
+    // Sample on a tick at the fastest channel's rate, and every few ticks for slower channels
+    uint32_t base_rate = 0;
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        base_rate = max(base_rate, (uint32_t)config.rate_hz[i]);
+    }
+    if (base_rate == 0 || base_rate > 1000000) {
+        return false;
+    }
+    for (int i = 0; i < CHANNEL_COUNT; i++) {
+        // Any other rate would be sampled at a different rate from the one asked for
+        if (config.rate_hz[i] && base_rate % config.rate_hz[i] != 0) {
+            return false;
+        }
+        dividers[i] = config.rate_hz[i] ? base_rate / config.rate_hz[i] : 0;
+    }
+
+    blocks = (block_t *)malloc(sizeof(block_t) * block_count);
+    if (!blocks) {
+        return false;
+    }
+
+    free_blocks = xQueueCreate(block_count, sizeof(uint8_t));
+    full_blocks = xQueueCreate(block_count + 1, sizeof(uint8_t));
+    for (uint8_t i = 0; i < block_count; i++) {
+        xQueueSend(free_blocks, &i, 0);
+    }
+
+    file = log_file;
+    sample = sample_cb;
+    sample_context = context;
+
+    // Extending the file once up front means FAT clusters aren't allocated while logging
+    if (config.preallocate_bytes) {
+        file.seek(config.preallocate_bytes - 1);
+        file.write((uint8_t)0);
+        file.seek(0);
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    stats = {};
+    portEXIT_CRITICAL(&stats_lock);
+    sequence = 0;
+    dropped = 0;
+    current = nullptr;
+    running = true;
+    done = false;
+
+    xTaskCreate(sampler_task, "datalog_sampler", 4096, this, 3, &sampler_task_handle);
+    xTaskCreate(writer_task, "datalog_writer", 4096, this, 1, NULL);
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = timer_callback;
+    timer_args.arg = this;
+    timer_args.name = "datalog";
+    esp_timer_create(&timer_args, &timer);
+    esp_timer_start_periodic(timer, 1000000 / base_rate);
+
+    return true;
+}
+
+void Logger::stop() {
+    if (!running) {
+        return;
+    }
+
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = nullptr;
+
+    // Notify the sampler it should flush and finish
+    running = false;
+    xTaskNotifyGive(sampler_task_handle);
+
+    // Wait for the writer to finish
+    while (!done) {
+        delay(10);
+    }
+
+    vQueueDelete(free_blocks);
+    vQueueDelete(full_blocks);
+    free(blocks);
+    blocks = nullptr;
+}
+
+stats_t Logger::get_stats() {
+    portENTER_CRITICAL(&stats_lock);
+    stats_t copy = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    return copy;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void Logger::add_record(uint32_t timestamp_us, channel_t channel, const int16_t values[3]) {
+    if (!current) {
+        uint8_t index;
+        if (xQueueReceive(free_blocks, &index, 0) != pdTRUE) {
+            // Every block is waiting on the card
+            dropped++;
+            portENTER_CRITICAL(&stats_lock);
+            stats.dropped_records++;
+            portEXIT_CRITICAL(&stats_lock);
+            return;
+        }
+
+        current = &blocks[index];
+        memset(current, 0, sizeof(block_t));
+        current->magic = block_magic;
+        current->sequence = sequence++;
+    }
+
+    record_t &record = current->records[current->record_count++];
+    record.timestamp_us = timestamp_us;
+    record.channel = channel;
+    memcpy(record.values, values, sizeof(record.values));
+    portENTER_CRITICAL(&stats_lock);
+    stats.records++;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (current->record_count == records_per_block) {
+        send_current_block();
+    }
+}
+
+void Logger::send_current_block() {
+    uint8_t index = current - blocks;
+    current->dropped = dropped;
+    dropped = 0;
+    current = nullptr;
+    xQueueSend(full_blocks, &index, 0);
+}
+
+void Logger::timer_callback(void *params) {
+    Logger *logger = static_cast<Logger *>(params);
+    xTaskNotifyGive(logger->sampler_task_handle);
+}
+
+void Logger::sampler_task(void *params) {
+    Logger *logger = static_cast<Logger *>(params);
+    uint32_t tick = 0;
+
+    while (logger->running) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!logger->running) {
+            break;
+        }
+
+        // More than one pending notification means sample times were skipped
+        portENTER_CRITICAL(&logger->stats_lock);
+        logger->stats.missed_ticks += ticks - 1;
+        portEXIT_CRITICAL(&logger->stats_lock);
+
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        for (int i = 0; i < CHANNEL_COUNT; i++) {
+            if (logger->dividers[i] && tick % logger->dividers[i] == 0) {
+                int16_t values[3] = {0, 0, 0};
+                if (logger->sample((channel_t)i, values, logger->sample_context)) {
+                    logger->add_record(now, (channel_t)i, values);
+                } else {
+                    // Counted with the records the card lost, so the gap shows in the file
+                    logger->dropped++;
+                    portENTER_CRITICAL(&logger->stats_lock);
+                    logger->stats.failed_reads++;
+                    portEXIT_CRITICAL(&logger->stats_lock);
+                }
+            }
+        }
+        tick++;
+    }
+
+    // Write out the partial block, then tell the writer to finish
+    if (logger->current) {
+        logger->send_current_block();
+    }
+    xQueueSend(logger->full_blocks, &STOP_WRITER, portMAX_DELAY);
+
+    // This task is done so delete itself
+    vTaskDelete(NULL);
+}
+
+void Logger::writer_task(void *params) {
+    Logger *logger = static_cast<Logger *>(params);
+    uint8_t index;
+
+    while (1) {
+        xQueueReceive(logger->full_blocks, &index, portMAX_DELAY);
+        if (index == STOP_WRITER) {
+            break;
+        }
+
+        logger->file.write((const uint8_t *)&logger->blocks[index], block_size);
+        portENTER_CRITICAL(&logger->stats_lock);
+        logger->stats.blocks_written++;
+        portEXIT_CRITICAL(&logger->stats_lock);
+        xQueueSend(logger->free_blocks, &index, 0);
+    }
+
+    logger->file.flush();
+    logger->file.close();
+
+    // Indicate to the main task that we are done
+    logger->done = true;
+
+    // This task is done so delete itself
+    vTaskDelete(NULL);
+}
+
+}; // namespace YDataLog
@@ -0,0 +1,305 @@
+#include "yfilter.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+namespace YAudio {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+static const int COEFF_BITS = 28;
+static const int32_t UNITY_GAIN = 1 << 15;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static inline int16_t saturate(int32_t value);
+static inline uint32_t cycle_count();
+
+////////////////////////////// Public Functions ///////////////////////////////
+void Biquad::design(FilterType new_type, uint32_t sample_rate, float frequency, float q,
+                    float gain_db) {
+    type = new_type;
+    if (gain_db > max_gain_db) {
+        gain_db = max_gain_db;
+    }
+
+    double w0 = 2 * M_PI * frequency / sample_rate;
+    double cos_w0 = cos(w0);
+    double alpha = sin(w0) / (2 * (q > 0 ? q : 0.7071));
+    double a = pow(10, gain_db / 40);
+    double root_a = 2 * sqrt(a) * alpha;
+    double nb0 = 1, nb1 = 0, nb2 = 0, na0 = 1, na1 = 0, na2 = 0;
+
+    switch (type) {
+    case FilterType::None:
+        break;
+    case FilterType::HighPass:
+        nb0 = (1 + cos_w0) / 2;
+        nb1 = -(1 + cos_w0);
+        nb2 = (1 + cos_w0) / 2;
+        na0 = 1 + alpha;
+        na1 = -2 * cos_w0;
+        na2 = 1 - alpha;
+        break;
+    case FilterType::LowPass:
+        nb0 = (1 - cos_w0) / 2;
+        nb1 = 1 - cos_w0;
+        nb2 = (1 - cos_w0) / 2;
+        na0 = 1 + alpha;
+        na1 = -2 * cos_w0;
+        na2 = 1 - alpha;
+        break;
+    case FilterType::LowShelf:
+        nb0 = a * ((a + 1) - (a - 1) * cos_w0 + root_a);
+        nb1 = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+        nb2 = a * ((a + 1) - (a - 1) * cos_w0 - root_a);
+        na0 = (a + 1) + (a - 1) * cos_w0 + root_a;
+        na1 = -2 * ((a - 1) + (a + 1) * cos_w0);
+        na2 = (a + 1) + (a - 1) * cos_w0 - root_a;
+        break;
+    case FilterType::HighShelf:
+        nb0 = a * ((a + 1) + (a - 1) * cos_w0 + root_a);
+        nb1 = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+        nb2 = a * ((a + 1) + (a - 1) * cos_w0 - root_a);
+        na0 = (a + 1) - (a - 1) * cos_w0 + root_a;
+        na1 = 2 * ((a - 1) - (a + 1) * cos_w0);
+        na2 = (a + 1) - (a - 1) * cos_w0 - root_a;
+        break;
+    case FilterType::Peaking:
+        nb0 = 1 + alpha * a;
+        nb1 = -2 * cos_w0;
+        nb2 = 1 - alpha * a;
+        na0 = 1 + alpha / a;
+        na1 = -2 * cos_w0;
+        na2 = 1 - alpha / a;
+        break;
+    }
+
+    // Q28 leaves room for the coefficients of a 12dB boost (up to about 7.96)
+    const double scale = (double)(1 << COEFF_BITS) / na0;
+    b0 = (int32_t)lround(nb0 * scale);
+    b1 = (int32_t)lround(nb1 * scale);
+    b2 = (int32_t)lround(nb2 * scale);
+    a1 = (int32_t)lround(na1 * scale);
+    a2 = (int32_t)lround(na2 * scale);
+}
+
+void Biquad::reset() {
+    x1 = x2 = y1 = y2 = 0;
+    error = 0;
+}
+
+void Biquad::process(int16_t *samples, size_t count) {
+    if (type == FilterType::None) {
+        return;
+    }
+
+    const int64_t mask = (1 << COEFF_BITS) - 1;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t x0 = samples[i];
+
+        // Direct form I, adding back the part of the last output that was rounded away
+        int64_t acc = (int64_t)b0 * x0 + (int64_t)b1 * x1 + (int64_t)b2 * x2 -
+                      (int64_t)a1 * y1 - (int64_t)a2 * y2 + error;
+        int32_t y0 = (int32_t)(acc >> COEFF_BITS);
+        error = (int32_t)(acc & mask);
+
+        int16_t out = saturate(y0);
+        x2 = x1;
+        x1 = x0;
+        y2 = y1;
+        y1 = out;
+        samples[i] = out;
+    }
+}
+
+void Limiter::begin(uint32_t sample_rate, float lookahead_ms, float release_ms) {
+    uint32_t samples = (uint32_t)(lookahead_ms * sample_rate / 1000);
+    lookahead = samples < 1 ? 1 : (samples > max_lookahead ? max_lookahead : samples);
+
+    // Recover about 99% of the way over the release time
+    float release_samples = release_ms * sample_rate / 1000;
+    release_coeff = (int32_t)(UNITY_GAIN * 4.6f / release_samples);
+    if (release_coeff > UNITY_GAIN) {
+        release_coeff = UNITY_GAIN;
+    }
+    if (release_coeff < 1) {
+        release_coeff = 1;
+    }
+
+    reset();
+}
+
+void Limiter::set_threshold(float threshold_db) {
+    if (threshold_db > 0) {
+        threshold_db = 0;
+    }
+    threshold = (int32_t)(32767 * powf(10, threshold_db / 20));
+    if (threshold < 1) {
+        threshold = 1;
+    }
+}
+
+void Limiter::reset() {
+    memset(delay, 0, sizeof(delay));
+    for (int i = 0; i <= lookahead; i++) {
+        needed[i] = UNITY_GAIN;
+        held[i] = UNITY_GAIN;
+    }
+    held_sum = UNITY_GAIN * (lookahead + 1);
+    gain = UNITY_GAIN;
+    pos = 0;
+    min_head = 0;
+    min_count = 0;
+}
+
+void Limiter::process(int16_t *samples, size_t count) {
+    const uint16_t window = lookahead + 1;
+
+    for (size_t i = 0; i < count; i++) {
+        // The gain this sample needs. Most samples are under the threshold, so divide rarely.
+        int32_t level = samples[i] < 0 ? -(int32_t)samples[i] : samples[i];
+        int32_t need = level > threshold ? (threshold << 15) / level : UNITY_GAIN;
+
+        // Running minimum over the window. The entry being overwritten leaves the front of the
+        // queue, and entries needing no less than the new one can never be the minimum again.
+        if (min_count && min_queue[min_head] == pos) {
+            min_head = (min_head + 1) % window;
+            min_count--;
+        }
+        while (min_count && needed[min_queue[(min_head + min_count - 1) % window]] >= need) {
+            min_count--;
+        }
+        needed[pos] = need;
+        min_queue[(min_head + min_count) % window] = pos;
+        min_count++;
+        int32_t minimum = needed[min_queue[min_head]];
+
+        // Moving average of the minimum over the same window. Every minimum averaged here
+        // covers the oldest sample, so the average never exceeds the gain that sample needs.
+        held_sum += minimum - held[pos];
+        held[pos] = minimum;
+        int32_t target = held_sum / window;
+
+        // Duck immediately, recover gradually
+        if (target < gain) {
+            gain = target;
+        } else {
+            gain += ((target - gain) * release_coeff + UNITY_GAIN - 1) >> 15;
+        }
+
+        // Output the oldest sample in the window
+        delay[pos] = samples[i];
+        pos = (pos + 1) % window;
+        samples[i] = (int16_t)(((int32_t)delay[pos] * gain) >> 15);
+    }
+}
+
+float Limiter::get_gain_reduction_db() const { return -20 * log10f((float)gain / UNITY_GAIN); }
+
+void EffectsChain::begin(uint32_t new_sample_rate) {
+    sample_rate = new_sample_rate;
+    limiter.begin(sample_rate, 1.5, 50);
+    limiter.set_threshold(-1);
+    reset();
+}
+
+void EffectsChain::reset() {
+    for (int i = 0; i < max_filters; i++) {
+        filters[i].reset();
+    }
+    limiter.reset();
+}
+
+void EffectsChain::set_filter(int index, FilterType type, float frequency, float q,
+                              float gain_db) {
+    if (index < 0 || index >= max_filters) {
+        return;
+    }
+    filters[index].design(type, sample_rate, frequency, q, gain_db);
+    filters[index].reset();
+}
+
+void EffectsChain::set_limiter(float threshold_db, float lookahead_ms, float release_ms) {
+    limiter.begin(sample_rate, lookahead_ms, release_ms);
+    limiter.set_threshold(threshold_db);
+}
+
+void EffectsChain::set_bypass(int stage, bool new_bypass) {
+    if (stage < 0 || stage >= stage_count) {
+        return;
+    }
+    if (bypass[stage] && !new_bypass) {
+        // Don't resume from stale state
+        if (stage == limiter_stage) {
+            limiter.reset();
+        } else {
+            filters[stage].reset();
+        }
+    }
+    bypass[stage] = new_bypass;
+}
+
+bool EffectsChain::get_bypass(int stage) const {
+    return stage >= 0 && stage < stage_count && bypass[stage];
+}
+
+void EffectsChain::process(int16_t *samples, size_t count) {
+    for (int i = 0; i < stage_count; i++) {
+        if (bypass[i] || (i < max_filters && filters[i].get_type() == FilterType::None)) {
+            continue;
+        }
+
+        uint32_t start = cycle_count();
+        if (i == limiter_stage) {
+            limiter.process(samples, count);
+        } else {
+            filters[i].process(samples, count);
+        }
+        cycles[i] += cycle_count() - start;
+        samples_processed[i] += count;
+    }
+}
+
+float EffectsChain::get_cycles_per_sample(int stage) const {
+    if (stage < 0 || stage >= stage_count || samples_processed[stage] == 0) {
+        return 0;
+    }
+    return (float)cycles[stage] / samples_processed[stage];
+}
+
+void EffectsChain::reset_stats() {
+    memset(cycles, 0, sizeof(cycles));
+    memset(samples_processed, 0, sizeof(samples_processed));
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+int16_t saturate(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+uint32_t cycle_count() {
+#ifdef ARDUINO
+    return ESP.getCycleCount();
+#else
+    // Off the badge, count nanoseconds instead
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+}; // namespace YAudio
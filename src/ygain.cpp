@@ -0,0 +1,117 @@
+#include "ygain.h"
+
+#include <string.h>
+
+// On the ESP32-S3 the steady state multiply uses the esp-dsp kernel, which is vectorized with the
+// PIE instructions. Define YAUDIO_NO_SIMD to always use the portable loop.
+#if defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(YAUDIO_NO_SIMD) && __has_include(<dsps_mulc.h>)
+#include <dsps_mulc.h>
+#define YAUDIO_GAIN_SIMD 1
+#endif
+
+namespace YAudio {
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static inline int16_t saturate(int32_t value);
+
+////////////////////////////// Public Functions ///////////////////////////////
+void GainStage::begin(uint16_t new_ramp_samples) {
+    ramp_samples = new_ramp_samples ? new_ramp_samples : 1;
+    current = 0;
+    last = 0;
+    start_ramp();
+}
+
+void GainStage::set_gain(float gain) {
+    if (gain < 0) {
+        gain = 0;
+    }
+    if (gain > max_gain) {
+        gain = max_gain;
+    }
+
+    int32_t new_target = (int32_t)(gain * unity + 0.5f);
+    if (new_target != target) {
+        target = new_target;
+        start_ramp();
+    }
+}
+
+void GainStage::process(int16_t *samples, size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t i = 0;
+
+    // Ramp section, one gain step per sample
+    for (; i < count && ramp_remaining; i++) {
+        ramp_remaining--;
+        current = ramp_remaining ? current + step : target;
+        samples[i] = saturate(((int32_t)samples[i] * (current >> 4)) >> 12);
+    }
+
+    // Steady section, a single gain for the rest of the buffer
+    int16_t *rest = samples + i;
+    size_t rest_count = count - i;
+
+    if (rest_count == 0 || current == unity) {
+        // Nothing to do
+    } else if (current == 0) {
+        memset(rest, 0, rest_count * sizeof(int16_t));
+    } else if (current < unity) {
+        // Attenuation can't overflow, so no saturation is needed
+#ifdef YAUDIO_GAIN_SIMD
+        dsps_mulc_s16(rest, rest, rest_count, (int16_t)(current >> 1), 1, 1);
+#else
+        int32_t gain = current >> 1;
+        for (size_t j = 0; j < rest_count; j++) {
+            rest[j] = (int16_t)(((int32_t)rest[j] * gain) >> 15);
+        }
+#endif
+    } else {
+        int32_t gain = current >> 4;
+        for (size_t j = 0; j < rest_count; j++) {
+            rest[j] = saturate(((int32_t)rest[j] * gain) >> 12);
+        }
+    }
+
+    last = samples[count - 1];
+}
+
+size_t GainStage::fade_out(int16_t *out, size_t max_samples) {
+    size_t n = 0;
+
+    // Step linearly from the last sample to zero over one ramp period
+    int32_t delta = ((int32_t)last + (last > 0 ? ramp_samples - 1 : 1 - ramp_samples)) /
+                    (int32_t)ramp_samples;
+    while (n < max_samples && last != 0) {
+        int32_t next = last - delta;
+        if ((last > 0 && next < 0) || (last < 0 && next > 0)) {
+            next = 0;
+        }
+        last = (int16_t)next;
+        out[n++] = last;
+    }
+
+    return n;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void GainStage::start_ramp() {
+    ramp_remaining = ramp_samples;
+    step = (target - current) / (int32_t)ramp_samples;
+}
+
+int16_t saturate(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+}; // namespace YAudio
@@ -0,0 +1,287 @@
+#include "yi2c.h"
+
+namespace YI2C {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+static const int HIGH_QUEUE_LENGTH = 16;
+static const int LOW_QUEUE_LENGTH = 32;
+
+typedef struct {
+    SemaphoreHandle_t done;
+    bool success;
+    size_t remaining;
+} waiter_t;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static void waiter_complete(bool success, void *context);
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool Bus::begin(int sda_pin, int scl_pin, uint32_t new_frequency) {
+    if (task_handle) {
+        set_frequency(new_frequency);
+        return true;
+    }
+
+    if (!Wire.begin(sda_pin, scl_pin, new_frequency)) {
+        return false;
+    }
+    frequency = new_frequency;
+
+    high_queue = xQueueCreate(HIGH_QUEUE_LENGTH, sizeof(request_t));
+    low_queue = xQueueCreate(LOW_QUEUE_LENGTH, sizeof(request_t));
+    reset_stats();
+
+    // Runs above the Arduino loop task so sensor reads are serviced promptly
+    xTaskCreate(bus_task, "i2c_bus_task", 4096, this, 2, &task_handle);
+
+    return true;
+}
+
+void Bus::set_frequency(uint32_t new_frequency) {
+    // Change the clock between transactions, never in the middle of one
+    run(0, [&]() { return Wire.setClock(new_frequency); });
+    frequency = new_frequency;
+}
+
+uint32_t Bus::get_frequency() const { return frequency; }
+
+bool Bus::submit(const transaction_t &transaction, Priority priority) {
+    request_t request = {transaction, nullptr, 0};
+    return enqueue(request, priority);
+}
+
+bool Bus::write(uint8_t address, const uint8_t *data, size_t len, Priority priority) {
+    request_t request = {{address, -1, data, len, nullptr, 0, nullptr, nullptr}, nullptr, 0};
+    return enqueue_and_wait(request, priority);
+}
+
+bool Bus::write_read(uint8_t address, const uint8_t *tx_data, size_t tx_len, uint8_t *rx_data,
+                     size_t rx_len, Priority priority) {
+    request_t request = {{address, -1, tx_data, tx_len, rx_data, rx_len, nullptr, nullptr},
+                         nullptr, 0};
+    return enqueue_and_wait(request, priority);
+}
+
+bool Bus::write_bulk(uint8_t address, uint8_t prefix, const uint8_t *data, size_t len,
+                     size_t chunk_size, Priority priority) {
+    if (len == 0 || chunk_size == 0) {
+        return true;
+    }
+
+    size_t chunks = (len + chunk_size - 1) / chunk_size;
+
+    // Without the bus task (or when called from it) there is nothing to interleave with
+    if (!task_handle || xTaskGetCurrentTaskHandle() == task_handle) {
+        bool success = true;
+        for (size_t offset = 0; offset < len; offset += chunk_size) {
+            request_t request = {{address, prefix, data + offset, min(chunk_size, len - offset),
+                                  nullptr, 0, nullptr, nullptr},
+                                 nullptr, (uint32_t)micros()};
+            success &= execute(request);
+        }
+        return success;
+    }
+
+    StaticSemaphore_t done_buffer;
+    waiter_t waiter = {xSemaphoreCreateBinaryStatic(&done_buffer), true, chunks};
+
+    for (size_t offset = 0; offset < len; offset += chunk_size) {
+        request_t request = {{address, prefix, data + offset, min(chunk_size, len - offset),
+                              nullptr, 0, waiter_complete, &waiter},
+                             nullptr, 0};
+        enqueue(request, priority);
+    }
+
+    xSemaphoreTake(waiter.done, portMAX_DELAY);
+    vSemaphoreDelete(waiter.done);
+
+    return waiter.success;
+}
+
+bool Bus::run(uint8_t address, const std::function<bool()> &job, Priority priority) {
+    request_t request = {{address, -1, nullptr, 0, nullptr, 0, nullptr, nullptr}, &job, 0};
+    return enqueue_and_wait(request, priority);
+}
+
+bool Bus::get_device_stats(uint8_t address, device_stats_t &stats) {
+    bool found = false;
+
+    portENTER_CRITICAL(&stats_lock);
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].address == address) {
+            stats = devices[i];
+            found = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    return found;
+}
+
+float Bus::get_utilization() {
+    uint32_t busy_us = 0;
+
+    portENTER_CRITICAL(&stats_lock);
+    for (int i = 0; i < device_count; i++) {
+        busy_us += devices[i].busy_us;
+    }
+    uint32_t elapsed_us = micros() - stats_start_us;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (elapsed_us == 0) {
+        return 0;
+    }
+    return min(1.0f, (float)busy_us / elapsed_us);
+}
+
+void Bus::reset_stats() {
+    portENTER_CRITICAL(&stats_lock);
+    for (int i = 0; i < device_count; i++) {
+        uint8_t address = devices[i].address;
+        devices[i] = {};
+        devices[i].address = address;
+    }
+    stats_start_us = micros();
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+bool Bus::enqueue(const request_t &request, Priority priority) {
+    request_t queued = request;
+    queued.queued_us = micros();
+
+    // Before the bus task exists there is only one user, so run it right away
+    if (!task_handle || xTaskGetCurrentTaskHandle() == task_handle) {
+        execute(queued);
+        return true;
+    }
+
+    QueueHandle_t queue = (priority == Priority::High) ? high_queue : low_queue;
+    if (xQueueSend(queue, &queued, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    xTaskNotifyGive(task_handle);
+    return true;
+}
+
+bool Bus::enqueue_and_wait(request_t &request, Priority priority) {
+    if (!task_handle || xTaskGetCurrentTaskHandle() == task_handle) {
+        request.queued_us = micros();
+        return execute(request);
+    }
+
+    StaticSemaphore_t done_buffer;
+    waiter_t waiter = {xSemaphoreCreateBinaryStatic(&done_buffer), true, 1};
+    request.transaction.on_complete = waiter_complete;
+    request.transaction.context = &waiter;
+
+    enqueue(request, priority);
+
+    xSemaphoreTake(waiter.done, portMAX_DELAY);
+    vSemaphoreDelete(waiter.done);
+
+    return waiter.success;
+}
+
+bool Bus::execute(request_t &request) {
+    transaction_t &t = request.transaction;
+    uint32_t start_us = micros();
+    bool success = true;
+    uint32_t bytes = 0;
+
+    if (request.job) {
+        success = (*request.job)();
+    } else {
+        if (t.tx_len || t.prefix >= 0) {
+            Wire.beginTransmission(t.address);
+            if (t.prefix >= 0) {
+                Wire.write((uint8_t)t.prefix);
+                bytes++;
+            }
+            bytes += Wire.write(t.tx_data, t.tx_len);
+            // Use a repeated start when a read follows
+            success = Wire.endTransmission(t.rx_len == 0) == 0;
+        }
+
+        if (success && t.rx_len) {
+            size_t received = Wire.requestFrom((uint16_t)t.address, t.rx_len, true);
+            received = Wire.readBytes(t.rx_data, received);
+            bytes += received;
+            success = received == t.rx_len;
+        }
+    }
+
+    uint32_t end_us = micros();
+    record(t.address, success, bytes, start_us - request.queued_us, end_us - start_us);
+
+    if (t.on_complete) {
+        t.on_complete(success, t.context);
+    }
+
+    return success;
+}
+
+void Bus::record(uint8_t address, bool success, uint32_t bytes, uint32_t wait_us,
+                 uint32_t busy_us) {
+    portENTER_CRITICAL(&stats_lock);
+
+    device_stats_t *device = nullptr;
+    for (int i = 0; i < device_count; i++) {
+        if (devices[i].address == address) {
+            device = &devices[i];
+            break;
+        }
+    }
+    if (!device && device_count < max_devices) {
+        device = &devices[device_count++];
+        device->address = address;
+    }
+
+    if (device) {
+        device->transactions++;
+        device->errors += success ? 0 : 1;
+        device->bytes += bytes;
+        device->busy_us += busy_us;
+        device->max_wait_us = max(device->max_wait_us, wait_us);
+    }
+
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void Bus::bus_task(void *params) {
+    Bus *bus = static_cast<Bus *>(params);
+    request_t request;
+
+    while (1) {
+        // Block waiting for something to do
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // Check the high priority queue again before every low priority transaction
+        while (1) {
+            if (xQueueReceive(bus->high_queue, &request, 0) == pdTRUE ||
+                xQueueReceive(bus->low_queue, &request, 0) == pdTRUE) {
+                bus->execute(request);
+            } else {
+                break;
+            }
+        }
+    }
+}
+
+void waiter_complete(bool success, void *context) {
+    waiter_t *waiter = static_cast<waiter_t *>(context);
+
+    if (!success) {
+        waiter->success = false;
+    }
+
+    if (--waiter->remaining == 0) {
+        xSemaphoreGive(waiter->done);
+    }
+}
+
+}; // namespace YI2C
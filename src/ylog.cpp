@@ -0,0 +1,248 @@
+#include "ylog.h"
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+
+namespace YLog {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Long enough for a message with its arguments filled in
+static const size_t LINE_BYTES = 160;
+
+// The same priority as loop() and the speaker task, so printing shares time with them and waits
+// behind the I2C bus and the samplers. The idle priority would be lower, but loop() rarely
+// blocks, so the drain would never run and every message would be dropped.
+static const int DRAIN_TASK_PRIORITY = 1;
+static const uint32_t DRAIN_IDLE_MS = 100;
+
+static_assert((ring_records & (ring_records - 1)) == 0, "Ring size must be a power of two");
+
+// Each slot's sequence number says whose turn it is: the producer writing record n waits for
+// it to be n, and the drain reading record n waits for it to be n + 1. Slots store it less
+// their own position in the ring, so the ring starts out ready when zeroed.
+typedef struct {
+    std::atomic<uint32_t> sequence;
+    record_t record;
+} slot_t;
+
+static slot_t ring[ring_records];
+static std::atomic<uint32_t> write_index(0);
+static uint32_t read_index = 0;
+static std::atomic<uint32_t> dropped(0);
+static std::atomic<bool> started(false);
+static TaskHandle_t drain_task_handle = nullptr;
+static SemaphoreHandle_t output_mutex = nullptr; // Keeps binary data out of printed lines
+
+volatile level_t runtime_level = LEVEL_DEBUG;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static void drain_task(void *params);
+static size_t format_record(const record_t &record, char *line, size_t size);
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool begin() {
+    bool expected = false;
+    if (!started.compare_exchange_strong(expected, true)) {
+        return true;
+    }
+
+    output_mutex = xSemaphoreCreateMutex();
+    return xTaskCreate(drain_task, "log_drain_task", 4096, NULL, DRAIN_TASK_PRIORITY,
+                       &drain_task_handle) == pdPASS;
+}
+
+void set_level(level_t level) { runtime_level = level; }
+
+level_t get_level() { return runtime_level; }
+
+uint32_t get_dropped() { return dropped.load(std::memory_order_relaxed); }
+
+bool write_binary(const uint8_t *data, size_t len) {
+    if (!started.load(std::memory_order_acquire)) {
+        begin();
+    }
+    if (!output_mutex || !xSemaphoreTake(output_mutex, 0)) {
+        return false;
+    }
+
+    bool room = Serial.availableForWrite() >= (int)len;
+    if (room) {
+        Serial.write(data, len);
+    }
+
+    xSemaphoreGive(output_mutex);
+    return room;
+}
+
+void submit(const record_t &record) {
+    if (!started.load(std::memory_order_acquire)) {
+        begin();
+    }
+
+    // Claim the next slot, unless the drain hasn't finished with it
+    uint32_t index = write_index.load(std::memory_order_relaxed);
+    slot_t *slot;
+    while (true) {
+        uint32_t position = index & (ring_records - 1);
+        slot = &ring[position];
+        uint32_t sequence = slot->sequence.load(std::memory_order_acquire) + position;
+        int32_t turn = (int32_t)(sequence - index);
+        if (turn == 0) {
+            if (write_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (turn < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            index = write_index.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->record = record;
+    slot->record.time_ms = millis();
+    slot->sequence.store(index + 1 - (index & (ring_records - 1)), std::memory_order_release);
+
+    if (drain_task_handle) {
+        xTaskNotifyGive(drain_task_handle);
+    }
+}
+
+void add_text(record_t &record, const char *text) {
+    size_t space = max_text - record.text_used;
+    if (space == 0) {
+        // No room at all, so share the terminator of the previous string
+        record.args[record.arg_count++] = max_text - 1;
+        return;
+    }
+
+    size_t len = text ? strnlen(text, space - 1) : 0;
+    memcpy(record.text + record.text_used, text, len);
+    record.text[record.text_used + len] = '\0';
+    record.args[record.arg_count++] = record.text_used;
+    record.text_used += len + 1;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void drain_task(void *params) {
+    char line[LINE_BYTES];
+    uint32_t reported_dropped = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(DRAIN_IDLE_MS));
+
+        while (true) {
+            uint32_t position = read_index & (ring_records - 1);
+            slot_t *slot = &ring[position];
+            if (slot->sequence.load(std::memory_order_acquire) + position != read_index + 1) {
+                break;
+            }
+
+            // Format a copy, so the slot can be handed back before waiting on the port
+            record_t record = slot->record;
+            slot->sequence.store(read_index + ring_records - position, std::memory_order_release);
+            read_index++;
+
+            format_record(record, line, sizeof(line));
+            xSemaphoreTake(output_mutex, portMAX_DELAY);
+            Serial.println(line);
+            xSemaphoreGive(output_mutex);
+        }
+
+        uint32_t now_dropped = get_dropped();
+        if (now_dropped != reported_dropped) {
+            unsigned count = now_dropped - reported_dropped;
+            xSemaphoreTake(output_mutex, portMAX_DELAY);
+            Serial.printf("(%u log messages dropped)\n", count);
+            xSemaphoreGive(output_mutex);
+            reported_dropped = now_dropped;
+        }
+    }
+}
+
+// A small printf that takes its arguments from the record. Each conversion is passed to
+// snprintf on its own, without any length modifier since every argument is 32 bits.
+size_t format_record(const record_t &record, char *line, size_t size) {
+    const char *format = record.format;
+    size_t len = 0;
+    uint8_t next_arg = 0;
+
+    line[0] = '\0';
+    while (*format && len + 1 < size) {
+        if (*format != '%') {
+            line[len++] = *format++;
+            continue;
+        }
+        if (format[1] == '%') {
+            line[len++] = '%';
+            format += 2;
+            continue;
+        }
+
+        // Flags, width and precision, then skip the length
+        char spec[16] = "%";
+        size_t spec_len = 1;
+        const char *p = format + 1;
+        while (*p && strchr("-+ #0123456789.", *p) && spec_len < sizeof(spec) - 2) {
+            spec[spec_len++] = *p++;
+        }
+        while (*p && strchr("hlLzjt", *p)) {
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion || next_arg >= record.arg_count) {
+            // Malformed or missing its argument, so print it as it is
+            line[len++] = *format++;
+            continue;
+        }
+        spec[spec_len++] = conversion;
+        spec[spec_len] = '\0';
+        format = p + 1;
+
+        uint32_t arg = record.args[next_arg++];
+        int written;
+        switch (conversion) {
+        case 's':
+            // An offset past the text means the argument wasn't a string
+            written = snprintf(line + len, size - len, spec,
+                               arg < max_text ? record.text + arg : "");
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G': {
+            union {
+                uint32_t u;
+                float f;
+            } bits;
+            bits.u = arg;
+            written = snprintf(line + len, size - len, spec, (double)bits.f);
+            break;
+        }
+        case 'd':
+        case 'i':
+            written = snprintf(line + len, size - len, spec, (int)(int32_t)arg);
+            break;
+        case 'p':
+            written = snprintf(line + len, size - len, spec, (void *)(uintptr_t)arg);
+            break;
+        default:
+            written = snprintf(line + len, size - len, spec, (unsigned)arg);
+            break;
+        }
+
+        if (written > 0) {
+            len = len + written < size ? len + written : size - 1;
+        }
+    }
+
+    line[len] = '\0';
+    return len;
+}
+
+}; // namespace YLog
@@ -0,0 +1,197 @@
+#include "ymirror.h"
+#include "ylog.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace YMirror {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Each page is sent whole once every this many frames, one page at a time
+static const uint16_t KEY_INTERVAL_FRAMES = 32;
+
+// Runs of at least this many equal bytes are repeated rather than copied
+static const size_t MIN_REPEAT = 3;
+static const size_t MAX_REPEAT = 130;
+static const size_t MAX_COPY = 128;
+
+// Copying a whole segment costs one control byte per MAX_COPY bytes
+static const size_t MAX_PAYLOAD = segment_width + (segment_width + MAX_COPY - 1) / MAX_COPY;
+
+static_assert(header_size + MAX_PAYLOAD + checksum_size <= YLog::max_binary_write,
+              "A packet must fit in the serial port's buffer");
+static_assert(DisplayMirror::max_segments <= 16, "key_due has a bit for each segment");
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static size_t run_length_encode(const uint8_t *data, size_t len, uint8_t *out);
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool DisplayMirror::begin(int new_width, int new_pages) {
+    if (new_width <= 0 || new_width > max_width || new_pages <= 0 || new_pages > max_pages) {
+        return false;
+    }
+
+    end();
+    width = new_width;
+    pages = new_pages;
+    sent = (uint8_t *)calloc(width * pages, 1);
+    if (!sent) {
+        return false;
+    }
+
+    // The receiver's copy is unknown, so start with every segment whole
+    key_due = (1 << (pages * segments_per_page())) - 1;
+    first_page = 0;
+    frame = 0;
+    bytes_sent = 0;
+    pages_deferred = 0;
+    return true;
+}
+
+void DisplayMirror::end() {
+    free(sent);
+    sent = nullptr;
+}
+
+void DisplayMirror::send(const uint8_t *buffer) {
+    if (!sent) {
+        return;
+    }
+
+    int segments = segments_per_page();
+    if (frame % KEY_INTERVAL_FRAMES == 0) {
+        int page = (frame / KEY_INTERVAL_FRAMES) % pages;
+        key_due |= ((1 << segments) - 1) << (page * segments);
+    }
+
+    bool any_sent = false;
+    int next_first_page = -1;
+    for (int i = 0; i < pages; i++) {
+        int page = (first_page + i) % pages;
+        bool deferred = false;
+        for (int x = 0; x < width; x += segment_width) {
+            int len = width - x < segment_width ? width - x : segment_width;
+            uint16_t segment_bit = 1 << (page * segments + x / segment_width);
+            bool key = key_due & segment_bit;
+            const uint8_t *data = buffer + page * width + x;
+            uint8_t *copy = sent + page * width + x;
+            if (!key && memcmp(data, copy, len) == 0) {
+                continue;
+            }
+
+            if (send_segment(page, x, len, data, key)) {
+                memcpy(copy, data, len);
+                key_due &= ~segment_bit;
+                any_sent = true;
+            } else {
+                deferred = true;
+            }
+        }
+
+        if (deferred) {
+            pages_deferred++;
+            if (next_first_page < 0) {
+                next_first_page = page;
+            }
+        }
+    }
+    if (next_first_page >= 0) {
+        first_page = next_first_page;
+    }
+
+    // A frame without changes isn't sent at all
+    if (any_sent) {
+        send_packet(packet_end, pages, 0, nullptr, 0);
+        frame++;
+    }
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+bool DisplayMirror::send_segment(int page, int x, int len, const uint8_t *data, bool key) {
+    uint8_t changes[segment_width];
+    const uint8_t *source = data;
+    if (!key) {
+        for (int i = 0; i < len; i++) {
+            changes[i] = data[i] ^ sent[page * width + x + i];
+        }
+        source = changes;
+    }
+
+    uint8_t payload[MAX_PAYLOAD];
+    size_t payload_len = run_length_encode(source, len, payload);
+    return send_packet(key ? packet_key : packet_delta, page, x, payload, payload_len);
+}
+
+bool DisplayMirror::send_packet(uint8_t type, uint8_t page, uint8_t x, const uint8_t *payload,
+                                size_t len) {
+    uint8_t packet[header_size + MAX_PAYLOAD + checksum_size];
+    packet[0] = sync_bytes[0];
+    packet[1] = sync_bytes[1];
+    packet[2] = type;
+    packet[3] = frame & 0xFF;
+    packet[4] = frame >> 8;
+    packet[5] = page;
+    packet[6] = x;
+    packet[7] = width;
+    packet[8] = len & 0xFF;
+    packet[9] = len >> 8;
+    memcpy(packet + header_size, payload, len);
+
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+    for (size_t i = 2; i < header_size + len; i++) {
+        sum1 = (sum1 + packet[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+    packet[header_size + len] = sum1;
+    packet[header_size + len + 1] = sum2;
+
+    size_t packet_len = header_size + len + checksum_size;
+    if (!YLog::write_binary(packet, packet_len)) {
+        return false;
+    }
+    bytes_sent += packet_len;
+    return true;
+}
+
+size_t run_length_encode(const uint8_t *data, size_t len, uint8_t *out) {
+    size_t out_len = 0;
+    size_t i = 0;
+    size_t copy_start = 0;
+
+    while (i < len) {
+        size_t run = 1;
+        while (i + run < len && data[i + run] == data[i] && run < MAX_REPEAT) {
+            run++;
+        }
+
+        if (run < MIN_REPEAT && i - copy_start + run <= MAX_COPY) {
+            i += run;
+            continue;
+        }
+
+        // Flush the bytes waiting to be copied, then this byte
+        if (i > copy_start) {
+            out[out_len++] = i - copy_start - 1;
+            memcpy(out + out_len, data + copy_start, i - copy_start);
+            out_len += i - copy_start;
+        }
+        if (run >= MIN_REPEAT) {
+            out[out_len++] = run + 125;
+            out[out_len++] = data[i];
+            i += run;
+        }
+        copy_start = i;
+    }
+
+    if (i > copy_start) {
+        out[out_len++] = i - copy_start - 1;
+        memcpy(out + out_len, data + copy_start, i - copy_start);
+        out_len += i - copy_start;
+    }
+    return out_len;
+}
+
+}; // namespace YMirror
@@ -0,0 +1,158 @@
+#include "yorientation.h"
+
+namespace YOrientation {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Filtered readings keep this many extra bits, so slow changes aren't lost to rounding
+static const int FILTER_SHIFT = 4;
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool Service::start(uint16_t rate_hz, float cutoff_hz, sample_cb_t sample_cb, void *context) {
+    if (running || !done || rate_hz == 0 || !sample_cb) {
+        return false;
+    }
+
+    // The weight of a first-order low-pass filter sampled at rate_hz
+    alpha = 1 << 16;
+    if (cutoff_hz > 0) {
+        alpha = (int32_t)((1 - expf(-2 * PI * cutoff_hz / rate_hz)) * (1 << 16));
+        alpha = constrain(alpha, 1, 1 << 16);
+    }
+
+    sample = sample_cb;
+    sample_context = context;
+    latest = {};
+    portENTER_CRITICAL(&lock);
+    stats = {};
+    portEXIT_CRITICAL(&lock);
+
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = timer_callback;
+    timer_args.arg = this;
+    timer_args.name = "orientation";
+    if (esp_timer_create(&timer_args, &timer) != ESP_OK) {
+        timer = nullptr;
+        return false;
+    }
+
+    running = true;
+    done = false;
+    if (xTaskCreate(sampler_task, "orientation", 4096, this, 3, &task_handle) != pdPASS) {
+        task_handle = nullptr;
+        running = false;
+        done = true;
+        esp_timer_delete(timer);
+        timer = nullptr;
+        return false;
+    }
+
+    if (esp_timer_start_periodic(timer, 1000000 / rate_hz) != ESP_OK) {
+        // The task is waiting for its first tick, so wake it to see it should finish
+        running = false;
+        xTaskNotifyGive(task_handle);
+        while (!done) {
+            delay(1);
+        }
+        esp_timer_delete(timer);
+        timer = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void Service::stop() {
+    if (!running) {
+        return;
+    }
+
+    esp_timer_stop(timer);
+    esp_timer_delete(timer);
+    timer = nullptr;
+
+    running = false;
+    xTaskNotifyGive(task_handle);
+    while (!done) {
+        delay(1);
+    }
+}
+
+estimate_t Service::get() {
+    portENTER_CRITICAL(&lock);
+    estimate_t estimate = latest;
+    portEXIT_CRITICAL(&lock);
+    return estimate;
+}
+
+stats_t Service::get_stats() {
+    portENTER_CRITICAL(&lock);
+    stats_t copy = stats;
+    portEXIT_CRITICAL(&lock);
+    return copy;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void Service::update(const int16_t values[3], uint32_t timestamp_us) {
+    // Only this task changes samples, so it can be read without the lock
+    for (int i = 0; i < 3; i++) {
+        int32_t reading = (int32_t)values[i] << FILTER_SHIFT;
+        if (stats.samples == 0) {
+            // Start from the first reading rather than rising from zero
+            filtered[i] = reading;
+        } else {
+            filtered[i] += (int32_t)(((int64_t)(reading - filtered[i]) * alpha) >> 16);
+        }
+    }
+
+    // Work out the angles before taking the lock, so get() is never kept waiting on them
+    estimate_t estimate;
+    solve(filtered[0] >> FILTER_SHIFT, filtered[1] >> FILTER_SHIFT,
+          filtered[2] >> FILTER_SHIFT, estimate);
+    estimate.timestamp_us = timestamp_us;
+    estimate.sequence = stats.samples + 1;
+
+    portENTER_CRITICAL(&lock);
+    latest = estimate;
+    stats.samples++;
+    portEXIT_CRITICAL(&lock);
+}
+
+void Service::timer_callback(void *params) {
+    Service *service = static_cast<Service *>(params);
+    xTaskNotifyGive(service->task_handle);
+}
+
+void Service::sampler_task(void *params) {
+    Service *service = static_cast<Service *>(params);
+
+    while (service->running) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!service->running) {
+            break;
+        }
+
+        uint32_t now = (uint32_t)esp_timer_get_time();
+        int16_t values[3];
+        bool read = service->sample(values, service->sample_context);
+        if (read) {
+            service->update(values, now);
+        }
+
+        // More than one pending notification means sample times were skipped
+        portENTER_CRITICAL(&service->lock);
+        service->stats.missed_ticks += ticks - 1;
+        if (!read) {
+            service->stats.failed_reads++;
+        }
+        portEXIT_CRITICAL(&service->lock);
+    }
+
+    service->done = true;
+
+    // This task is done so delete itself
+    vTaskDelete(NULL);
+}
+
+}; // namespace YOrientation
@@ -0,0 +1,144 @@
+#include "ypack.h"
+
+#include <string.h>
+
+namespace YAudio {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+static const uint32_t MAX_ENTRIES = 0xFFFE;
+
+// Longest name the names table may average, so a damaged header can't ask for all the RAM
+static const uint32_t MAX_NAME_BYTES = 256;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static uint32_t read_le32(const uint8_t *data);
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool AssetPack::open(File &pack_file) {
+    close();
+
+    uint8_t header[pack_header_size];
+    pack_file.seek(0);
+    if (pack_file.read(header, sizeof(header)) != sizeof(header) || header[0] != 'Y' ||
+        header[1] != 'P' || header[2] != 'A' || header[3] != 'K' ||
+        header[4] != pack_file_version) {
+        return false;
+    }
+
+    uint32_t count = read_le32(header + 8);
+    uint32_t names_size = read_le32(header + 12);
+    if (count == 0 || count > MAX_ENTRIES || names_size > count * MAX_NAME_BYTES) {
+        return false;
+    }
+
+    // Read the whole index in one go
+    std::vector<uint8_t> index(count * pack_entry_size);
+    if (pack_file.read(index.data(), index.size()) != index.size()) {
+        return false;
+    }
+
+    entries.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t *entry = &index[i * pack_entry_size];
+        entries[i].name_hash = read_le32(entry);
+        entries[i].offset = read_le32(entry + 4);
+        entries[i].length = read_le32(entry + 8);
+        entries[i].format = (pack_format_t)entry[12];
+
+        // A truncated pack would otherwise play garbage
+        if (entries[i].offset > pack_file.size() ||
+            entries[i].length > pack_file.size() - entries[i].offset) {
+            entries.clear();
+            return false;
+        }
+    }
+
+    // The names follow the index, each ending in a zero
+    names.resize(names_size);
+    if (pack_file.read((uint8_t *)names.data(), names.size()) != names.size()) {
+        entries.clear();
+        return false;
+    }
+    name_offsets.resize(count);
+    uint32_t name_start = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const char *end = nullptr;
+        if (name_start < names_size) {
+            end = (const char *)memchr(&names[name_start], 0, names_size - name_start);
+        }
+        if (!end) {
+            entries.clear();
+            return false;
+        }
+        name_offsets[i] = name_start;
+        name_start = end - names.data() + 1;
+    }
+
+    // Open addressing, at most half full so probes stay short
+    uint32_t slots = 1;
+    while (slots < count * 2) {
+        slots <<= 1;
+    }
+    table.assign(slots, 0);
+    table_mask = slots - 1;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t slot = entries[i].name_hash & table_mask;
+        while (table[slot]) {
+            slot = (slot + 1) & table_mask;
+        }
+        table[slot] = i + 1;
+    }
+
+    file = pack_file;
+    return true;
+}
+
+void AssetPack::close() {
+    entries.clear();
+    names.clear();
+    name_offsets.clear();
+    table.clear();
+    if (file) {
+        file.close();
+    }
+}
+
+int AssetPack::find(const char *name) const {
+    if (entries.empty()) {
+        return -1;
+    }
+
+    uint32_t hash = hash_name(name);
+    for (uint32_t slot = hash & table_mask; table[slot]; slot = (slot + 1) & table_mask) {
+        int id = table[slot] - 1;
+        if (entries[id].name_hash == hash && strcmp(&names[name_offsets[id]], name) == 0) {
+            return id;
+        }
+    }
+    return -1;
+}
+
+const pack_entry_t *AssetPack::get(int id) const {
+    if (id < 0 || (size_t)id >= entries.size()) {
+        return nullptr;
+    }
+    return &entries[id];
+}
+
+uint32_t AssetPack::hash_name(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+uint32_t read_le32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+}; // namespace YAudio
@@ -0,0 +1,343 @@
+#include "yresample.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace YAudio {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+// Fraction of the lower Nyquist frequency kept by the anti-alias filter
+static const double FILTER_CUTOFF = 0.9;
+
+// Filter length of a decimation stage, by factor. Longer filters have a sharper cutoff.
+static const uint16_t DECIMATE_BY_2_TAPS = 47;
+static const uint16_t DECIMATE_BY_3_TAPS = 71;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static uint32_t gcd(uint32_t a, uint32_t b);
+static double kernel(double t, uint16_t taps, double cutoff);
+static inline int16_t saturate(int32_t value);
+
+////////////////////////////// Public Functions ///////////////////////////////
+bool Resampler::begin(uint32_t new_in_rate, uint32_t new_out_rate, Quality new_quality) {
+    if (new_in_rate == 0 || new_out_rate == 0) {
+        return false;
+    }
+
+    in_rate = new_in_rate;
+    out_rate = new_out_rate;
+    quality = new_quality;
+
+    uint32_t divisor = gcd(in_rate, out_rate);
+    ratio_in = in_rate / divisor;
+    ratio_out = out_rate / divisor;
+    step_int = ratio_in / ratio_out;
+    step_rem = ratio_in % ratio_out;
+
+    switch (quality) {
+    case Quality::Fast:
+        taps = 2;
+        phases = 64;
+        break;
+    case Quality::Balanced:
+        taps = 8;
+        phases = 32;
+        break;
+    case Quality::High:
+        taps = 24;
+        phases = 64;
+        break;
+    }
+
+    // When downsampling the filter must also remove everything above the new Nyquist frequency
+    double cutoff = FILTER_CUTOFF * fmin(1.0, (double)out_rate / in_rate);
+
+    coefficients.assign(phases * taps, 0);
+    for (uint16_t p = 0; p < phases; p++) {
+        double frac = (double)p / phases;
+        double weights[24];
+        double sum = 0;
+
+        for (uint16_t j = 0; j < taps; j++) {
+            weights[j] = kernel(j - taps / 2 + frac, taps, cutoff);
+            sum += weights[j];
+        }
+
+        // Normalize each phase to unity gain at DC, and put any rounding error on the largest tap
+        int32_t total = 0;
+        uint16_t largest = 0;
+        for (uint16_t j = 0; j < taps; j++) {
+            int16_t c = (int16_t)lround(weights[j] / sum * 32767.0);
+            coefficients[p * taps + j] = c;
+            total += c;
+            if (abs(c) > abs(coefficients[p * taps + largest])) {
+                largest = j;
+            }
+        }
+        coefficients[p * taps + largest] += 32767 - total;
+    }
+
+    history.assign(taps * 2, 0);
+    reset();
+
+    return true;
+}
+
+void Resampler::reset() {
+    std::fill(history.begin(), history.end(), 0);
+    history_pos = 0;
+    phase_acc = 0;
+    skip = 1;
+}
+
+size_t Resampler::process(const int16_t *in, size_t in_count, size_t &in_used, int16_t *out,
+                          size_t out_capacity) {
+    if (is_passthrough()) {
+        in_used = (in_count < out_capacity) ? in_count : out_capacity;
+        if (out != in) {
+            memmove(out, in, in_used * sizeof(int16_t));
+        }
+        return in_used;
+    }
+
+    size_t produced = 0;
+    size_t used = 0;
+
+    while (1) {
+        if (skip == 0) {
+            if (produced == out_capacity) {
+                break;
+            }
+
+            out[produced++] = filter((uint32_t)((uint64_t)phase_acc * phases / ratio_out));
+
+            // Advance the output position by in_rate / out_rate input samples
+            skip = step_int;
+            phase_acc += step_rem;
+            if (phase_acc >= ratio_out) {
+                phase_acc -= ratio_out;
+                skip++;
+            }
+            continue;
+        }
+
+        if (used == in_count) {
+            break;
+        }
+
+        history_pos = (history_pos == 0) ? taps - 1 : history_pos - 1;
+        history[history_pos] = in[used];
+        history[history_pos + taps] = in[used];
+        used++;
+        skip--;
+    }
+
+    in_used = used;
+    return produced;
+}
+
+size_t Resampler::max_output(size_t in_count) const {
+    return ((uint64_t)in_count * ratio_out + ratio_in - 1) / ratio_in + 1;
+}
+
+void downmix_to_mono(const int16_t *in, int16_t *out, size_t frames, uint8_t channels) {
+    if (channels == 1) {
+        if (out != in) {
+            memmove(out, in, frames * sizeof(int16_t));
+        }
+        return;
+    }
+
+    if (channels == 2) {
+        for (size_t i = 0; i < frames; i++) {
+            out[i] = (int16_t)(((int32_t)in[2 * i] + in[2 * i + 1]) >> 1);
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (uint8_t c = 0; c < channels; c++) {
+            sum += in[i * channels + c];
+        }
+        out[i] = (int16_t)(sum / channels);
+    }
+}
+
+bool Decimator::begin(uint32_t in_rate, uint32_t out_rate) {
+    if (out_rate == 0 || in_rate % out_rate != 0) {
+        return false;
+    }
+
+    // Take out the factors of 3 first, so the longer filters run at the lower rates
+    factor = in_rate / out_rate;
+    stage_count = 0;
+    uint32_t remaining = factor;
+    while (remaining % 3 == 0 && stage_count < max_stages) {
+        add_stage(3);
+        remaining /= 3;
+    }
+    while (remaining % 2 == 0 && stage_count < max_stages) {
+        add_stage(2);
+        remaining /= 2;
+    }
+
+    if (remaining != 1) {
+        factor = 1;
+        stage_count = 0;
+        return false;
+    }
+
+    return true;
+}
+
+void Decimator::reset() {
+    for (int i = 0; i < stage_count; i++) {
+        std::fill(stages[i].history.begin(), stages[i].history.end(), 0);
+        stages[i].history_pos = 0;
+        stages[i].phase = 0;
+    }
+}
+
+size_t Decimator::process(const int16_t *in, size_t count, int16_t *out) {
+    if (stage_count == 0) {
+        if (out != in) {
+            memmove(out, in, count * sizeof(int16_t));
+        }
+        return count;
+    }
+
+    // Each stage writes no faster than it reads, so the later stages can work in place
+    count = process_stage(stages[0], in, count, out);
+    for (int i = 1; i < stage_count; i++) {
+        count = process_stage(stages[i], out, count, out);
+    }
+    return count;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void Decimator::add_stage(uint8_t stage_factor) {
+    stage_t &stage = stages[stage_count++];
+    stage.factor = stage_factor;
+    stage.taps = stage_factor == 3 ? DECIMATE_BY_3_TAPS : DECIMATE_BY_2_TAPS;
+
+    // A cutoff of exactly 1 / factor puts the zeros of the sinc on every factor-th tap
+    double cutoff = 1.0 / stage_factor;
+    uint16_t mid = stage.taps / 2;
+    double sum = 0;
+    for (uint16_t j = 0; j < stage.taps; j++) {
+        sum += kernel((double)j - mid, stage.taps, cutoff);
+    }
+
+    // Keep only the nonzero taps on one side, and put any rounding error on the center tap
+    stage.offsets.clear();
+    stage.coefficients.clear();
+    int32_t total = 0;
+    for (uint16_t offset = 1; offset <= mid; offset++) {
+        if (offset % stage_factor == 0) {
+            continue;
+        }
+        int16_t c = (int16_t)lround(kernel(offset, stage.taps, cutoff) / sum * 32767.0);
+        stage.offsets.push_back(offset);
+        stage.coefficients.push_back(c);
+        total += 2 * c;
+    }
+    stage.center = 32767 - total;
+
+    stage.history.assign(stage.taps * 2, 0);
+    stage.history_pos = 0;
+    stage.phase = 0;
+}
+
+size_t Decimator::process_stage(stage_t &stage, const int16_t *in, size_t count, int16_t *out) {
+    size_t produced = 0;
+    size_t pairs = stage.offsets.size();
+    uint16_t mid = stage.taps / 2;
+
+    for (size_t i = 0; i < count; i++) {
+        stage.history[stage.history_pos] = in[i];
+        stage.history[stage.history_pos + stage.taps] = in[i];
+        if (++stage.history_pos == stage.taps) {
+            stage.history_pos = 0;
+        }
+
+        if (++stage.phase < stage.factor) {
+            continue;
+        }
+        stage.phase = 0;
+
+        // The window runs from the oldest sample to the newest, and is symmetric about mid
+        const int16_t *center = &stage.history[stage.history_pos + mid];
+        int32_t acc = (int32_t)stage.center * center[0];
+        for (size_t k = 0; k < pairs; k++) {
+            uint8_t offset = stage.offsets[k];
+            acc += (int32_t)stage.coefficients[k] * (center[-offset] + center[offset]);
+        }
+        out[produced++] = saturate((acc + (1 << 14)) >> 15);
+    }
+
+    return produced;
+}
+
+int16_t Resampler::filter(uint32_t phase) const {
+    const int16_t *c = &coefficients[phase * taps];
+    const int16_t *x = &history[history_pos];
+
+    int32_t acc = 1 << 14;
+    for (uint16_t j = 0; j < taps; j++) {
+        acc += (int32_t)c[j] * x[j];
+    }
+    acc >>= 15;
+
+    if (acc > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (acc < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)acc;
+}
+
+uint32_t gcd(uint32_t a, uint32_t b) {
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+int16_t saturate(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+// Interpolation kernel evaluated t input samples away from the output position
+double kernel(double t, uint16_t taps, double cutoff) {
+    if (taps == 2) {
+        return fmax(0.0, 1.0 - fabs(t));
+    }
+
+    double half = taps / 2.0;
+    if (fabs(t) >= half) {
+        return 0;
+    }
+
+    double x = M_PI * cutoff * t;
+    double sinc = (x == 0) ? 1.0 : sin(x) / x;
+    double u = t / half;
+    double window = 0.42 + 0.5 * cos(M_PI * u) + 0.08 * cos(2 * M_PI * u);
+
+    return cutoff * sinc * window;
+}
+
+}; // namespace YAudio
@@ -0,0 +1,165 @@
+#include "yscheduler.h"
+
+namespace YScheduler {
+
+////////////////////////////// Public Functions ///////////////////////////////
+Scheduler::~Scheduler() {
+    if (timer) {
+        esp_timer_stop(timer);
+        esp_timer_delete(timer);
+    }
+    if (wake) {
+        vSemaphoreDelete(wake);
+    }
+}
+
+int Scheduler::add(const char *name, float rate_hz, const std::function<void()> &callback,
+                   uint32_t budget_us) {
+    if (count >= max_callbacks || rate_hz <= 0 || !callback) {
+        return -1;
+    }
+
+    entry_t &entry = entries[count];
+    entry.name = name;
+    entry.callback = callback;
+    entry.period_us = (uint32_t)(1000000 / rate_hz);
+    if (entry.period_us == 0) {
+        entry.period_us = 1;
+    }
+    entry.budget_us = budget_us ? budget_us : entry.period_us;
+    entry.next_due = esp_timer_get_time();
+    entry.stats = {};
+    entry.total_us = 0;
+    entry.total_jitter_us = 0;
+
+    return count++;
+}
+
+void Scheduler::set_flush(const std::function<void()> &new_flush) { flush = new_flush; }
+
+void Scheduler::run_once() {
+    if (count == 0) {
+        vTaskDelay(1);
+        return;
+    }
+
+    // Time spent between adding callbacks and running them isn't counted against them
+    if (!started) {
+        int64_t now = esp_timer_get_time();
+        for (int i = 0; i < count; i++) {
+            entries[i].next_due = now;
+        }
+        started = true;
+    }
+
+    int64_t next = entries[0].next_due;
+    for (int i = 1; i < count; i++) {
+        next = min(next, entries[i].next_due);
+    }
+    sleep_until(next);
+
+    // The time is read once, so a callback that runs long doesn't make later ones due early
+    int64_t now = esp_timer_get_time();
+    bool ran = false;
+    for (int i = 0; i < count; i++) {
+        entry_t &entry = entries[i];
+        if (entry.next_due > now) {
+            continue;
+        }
+
+        int64_t start = esp_timer_get_time();
+        entry.callback();
+        int64_t end = esp_timer_get_time();
+        ran = true;
+
+        uint32_t jitter = (uint32_t)(start - entry.next_due);
+        entry.stats.max_jitter_us = max(entry.stats.max_jitter_us, jitter);
+        entry.total_jitter_us += jitter;
+        record_run(entry.stats, entry.total_us, (uint32_t)(end - start));
+        entry.stats.average_jitter_us = entry.total_jitter_us / entry.stats.runs;
+        if (entry.stats.last_us > entry.budget_us) {
+            entry.stats.overruns++;
+        }
+
+        // Stay on the original schedule, skipping any ticks already past
+        entry.next_due += entry.period_us;
+        if (entry.next_due <= end) {
+            uint32_t behind = (uint32_t)((end - entry.next_due) / entry.period_us) + 1;
+            entry.next_due += (int64_t)behind * entry.period_us;
+            entry.stats.missed += behind;
+        }
+    }
+
+    if (ran && flush) {
+        int64_t start = esp_timer_get_time();
+        flush();
+        record_run(flush_stats, flush_total_us, (uint32_t)(esp_timer_get_time() - start));
+    }
+}
+
+const char *Scheduler::get_name(int id) const {
+    return id >= 0 && id < count ? entries[id].name : nullptr;
+}
+
+uint32_t Scheduler::get_budget(int id) const {
+    return id >= 0 && id < count ? entries[id].budget_us : 0;
+}
+
+bool Scheduler::get_stats(int id, stats_t &stats) const {
+    if (id < 0 || id >= count) {
+        return false;
+    }
+    stats = entries[id].stats;
+    return true;
+}
+
+stats_t Scheduler::get_flush_stats() const { return flush_stats; }
+
+void Scheduler::reset_stats() {
+    for (int i = 0; i < count; i++) {
+        entries[i].stats = {};
+        entries[i].total_us = 0;
+        entries[i].total_jitter_us = 0;
+    }
+    flush_stats = {};
+    flush_total_us = 0;
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+// Blocks on a one-shot timer rather than vTaskDelay, whose 1ms ticks would be most of a
+// period at the faster rates
+void Scheduler::sleep_until(int64_t time) {
+    int64_t wait = time - esp_timer_get_time();
+    if (wait <= 0) {
+        return;
+    }
+
+    if (!timer) {
+        wake = xSemaphoreCreateBinary();
+
+        esp_timer_create_args_t timer_args = {};
+        timer_args.callback = timer_callback;
+        timer_args.arg = this;
+        timer_args.name = "scheduler";
+        esp_timer_create(&timer_args, &timer);
+    }
+
+    esp_timer_start_once(timer, wait);
+    xSemaphoreTake(wake, portMAX_DELAY);
+}
+
+void Scheduler::record_run(stats_t &stats, uint64_t &total_us, uint32_t duration_us) {
+    stats.runs++;
+    stats.last_us = duration_us;
+    stats.max_us = max(stats.max_us, duration_us);
+    total_us += duration_us;
+    stats.average_us = total_us / stats.runs;
+}
+
+void Scheduler::timer_callback(void *params) {
+    Scheduler *scheduler = (Scheduler *)params;
+    xSemaphoreGive(scheduler->wake);
+}
+
+}; // namespace YScheduler
@@ -0,0 +1,158 @@
+#include "yvoice.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace YAudio {
+
+///////////////////////////////// Configuration Constants //////////////////////
+
+static const int SINE_TABLE_BITS = 8;
+static const uint32_t PITCH_DELAY_MASK = (VoiceEffects::pitch_window << 16) - 1;
+
+static_assert((VoiceEffects::pitch_window & (VoiceEffects::pitch_window - 1)) == 0,
+              "Pitch window must be a power of two");
+static_assert((VoiceEffects::max_echo_samples & (VoiceEffects::max_echo_samples - 1)) == 0,
+              "Echo buffer must be a power of two");
+
+// One cycle of a sine wave, Q15, shared by every instance
+static int16_t sine_table[1 << SINE_TABLE_BITS];
+static bool sine_table_ready = false;
+
+//////////////////////////// Private Function Prototypes ///////////////////////
+static inline int16_t saturate(int32_t value);
+
+////////////////////////////// Public Functions ///////////////////////////////
+void VoiceEffects::begin(uint32_t new_sample_rate) {
+    sample_rate = new_sample_rate;
+
+    if (!sine_table_ready) {
+        for (int i = 0; i < (1 << SINE_TABLE_BITS); i++) {
+            sine_table[i] = (int16_t)(32767 * sinf(2 * M_PI * i / (1 << SINE_TABLE_BITS)));
+        }
+        sine_table_ready = true;
+    }
+
+    reset();
+}
+
+void VoiceEffects::reset() {
+    memset(pitch_buffer, 0, sizeof(pitch_buffer));
+    memset(echo_buffer, 0, sizeof(echo_buffer));
+    pitch_write = 0;
+    pitch_delay = 0;
+    robot_phase = 0;
+    echo_pos = 0;
+}
+
+void VoiceEffects::set_pitch(float ratio) {
+    if (ratio < 0.5f) {
+        ratio = 0.5f;
+    }
+    if (ratio > 2.0f) {
+        ratio = 2.0f;
+    }
+
+    // The delay shrinks when reading faster than writing (higher pitch) and grows when slower
+    pitch_step = (int32_t)lroundf((1.0f - ratio) * 65536);
+}
+
+void VoiceEffects::set_robot(uint16_t frequency) {
+    robot_step = (uint32_t)(((uint64_t)frequency << 32) / sample_rate);
+}
+
+void VoiceEffects::set_echo(uint16_t delay_ms, float feedback) {
+    if (feedback < 0) {
+        feedback = 0;
+    }
+    if (feedback > 0.9f) {
+        feedback = 0.9f;
+    }
+
+    uint32_t delay_samples = (uint32_t)delay_ms * sample_rate / 1000;
+    if (delay_samples >= max_echo_samples) {
+        delay_samples = max_echo_samples - 1;
+    }
+
+    echo_feedback = (int16_t)(feedback * 32767);
+    echo_delay = delay_samples;
+}
+
+void VoiceEffects::process(int16_t *samples, size_t count) {
+    if (pitch_step) {
+        process_pitch(samples, count);
+    }
+    if (robot_step) {
+        process_robot(samples, count);
+    }
+    if (echo_delay && echo_feedback) {
+        process_echo(samples, count);
+    }
+}
+
+////////////////////////////// Private Functions ///////////////////////////////
+
+void VoiceEffects::process_pitch(int16_t *samples, size_t count) {
+    const uint32_t half = pitch_window << 15;
+    int32_t step = pitch_step;
+
+    for (size_t i = 0; i < count; i++) {
+        pitch_buffer[pitch_write] = samples[i];
+
+        // Each head is read with linear interpolation and weighted by a triangle that is zero
+        // where the head wraps. The heads are half a window apart, so the weights sum to one.
+        int32_t out = 0;
+        uint32_t delay = pitch_delay;
+        for (int head = 0; head < 2; head++) {
+            uint32_t pos = (((uint32_t)pitch_write << 16) - delay) & PITCH_DELAY_MASK;
+            uint16_t i0 = pos >> 16;
+            int32_t a = pitch_buffer[i0];
+            int32_t b = pitch_buffer[(i0 + 1) & (pitch_window - 1)];
+            int32_t tap = a + (((b - a) * (int32_t)(pos & 0xFFFF)) >> 16);
+
+            uint32_t triangle = delay < half ? delay : (PITCH_DELAY_MASK + 1) - delay;
+            out += tap * (int32_t)(triangle / pitch_window);
+
+            delay = (delay + half) & PITCH_DELAY_MASK;
+        }
+        samples[i] = saturate(out >> 15);
+
+        pitch_delay = (pitch_delay + step) & PITCH_DELAY_MASK;
+        pitch_write = (pitch_write + 1) & (pitch_window - 1);
+    }
+}
+
+void VoiceEffects::process_robot(int16_t *samples, size_t count) {
+    uint32_t step = robot_step;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t carrier = sine_table[robot_phase >> (32 - SINE_TABLE_BITS)];
+        samples[i] = (int16_t)(((int32_t)samples[i] * carrier) >> 15);
+        robot_phase += step;
+    }
+}
+
+void VoiceEffects::process_echo(int16_t *samples, size_t count) {
+    uint16_t delay = echo_delay;
+    int32_t feedback = echo_feedback;
+
+    for (size_t i = 0; i < count; i++) {
+        int32_t delayed = echo_buffer[(echo_pos - delay) & (max_echo_samples - 1)];
+        int16_t out = saturate(samples[i] + ((delayed * feedback) >> 15));
+        echo_buffer[echo_pos] = out;
+        samples[i] = out;
+        echo_pos = (echo_pos + 1) & (max_echo_samples - 1);
+    }
+}
+
+int16_t saturate(int32_t value) {
+    if (value > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (value < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)value;
+}
+
+}; // namespace YAudio
@@ -0,0 +1,140 @@
+/*
+ * Times the speaker's gain stage (see ygain.h) against the VolumeStream and PoppingSoundRemover
+ * pair it replaced, on blocks the size the speaker writes, and checks that both give the same
+ * level.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -O2 -std=c++14 -I../include bench_gain.cpp ../src/ygain.cpp -o bench_gain
+ *     ./bench_gain
+ *
+ * arduino-audio-tools doesn't build on a computer, so the old path is the per-sample work of
+ * its VolumeStream and PoppingSoundRemover (version 1.0.1) written out here. The times are for
+ * your computer, and on x86 the time stamp counter is also given in cycles per sample. The
+ * Y-Board uses the esp-dsp multiply for attenuation, which this doesn't cover.
+ */
+
+#include "ygain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+using namespace YAudio;
+
+static const size_t block_samples = 128; // The resampler's output block
+static const size_t total_samples = 16000 * 600;
+
+// VolumeStream::applyVolume16: a float factor per sample, clipped when boosting
+static void old_volume(int16_t *data, size_t count, float factor) {
+    for (size_t i = 0; i < count; i++) {
+        float result = factor * data[i];
+        if (result > INT16_MAX) {
+            result = INT16_MAX;
+        } else if (result < INT16_MIN) {
+            result = INT16_MIN;
+        }
+        data[i] = (int16_t)result;
+    }
+}
+
+// PoppingSoundRemover<int16_t>(1, true, true)::convert: zero the samples before the first and
+// after the last zero crossing of each block
+static void old_popping_remover(int16_t *data, size_t count) {
+    int16_t first = data[0];
+    for (size_t i = 0; i < count; i++) {
+        int16_t value = data[i];
+        if ((first <= 0 && value >= 0) || (first >= 0 && value <= 0)) {
+            break;
+        }
+        data[i] = 0;
+    }
+
+    int16_t last = data[count - 1];
+    for (size_t i = count; i-- > 0;) {
+        int16_t value = data[i];
+        if ((last <= 0 && value >= 0) || (last >= 0 && value <= 0)) {
+            break;
+        }
+        data[i] = 0;
+    }
+}
+
+struct timing_t {
+    double ns;
+    double cycles;
+};
+
+template <typename F> static timing_t time_blocks(const std::vector<int16_t> &source, F process) {
+    std::vector<int16_t> block(block_samples);
+    auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+    uint64_t start_cycles = __rdtsc();
+#endif
+    for (size_t pos = 0; pos + block_samples <= total_samples; pos += block_samples) {
+        std::copy(source.begin() + pos % source.size(),
+                  source.begin() + pos % source.size() + block_samples, block.begin());
+        process(block.data(), block_samples);
+    }
+    timing_t timing = {};
+#ifdef HAVE_TSC
+    timing.cycles = (double)(__rdtsc() - start_cycles) / total_samples;
+#endif
+    timing.ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+        total_samples;
+    return timing;
+}
+
+static void report(const char *name, timing_t timing) {
+    printf("  %-28s %8.2f ns %8.2f cycles\n", name, timing.ns, timing.cycles);
+}
+
+int main() {
+    // A second of a 440Hz tone at a quarter of full scale, reused block by block
+    std::vector<int16_t> source(16000 + block_samples);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (int16_t)(8192 * sin(2 * M_PI * 440 * i / 16000.0));
+    }
+
+    bool ok = true;
+    const float gains[] = {0.5f, 2.0f};
+    for (float gain : gains) {
+        printf("Gain %.1f, per sample including copying the block in:\n", gain);
+
+        report("VolumeStream + remover", time_blocks(source, [gain](int16_t *data, size_t count) {
+                   old_volume(data, count, gain);
+                   old_popping_remover(data, count);
+               }));
+
+        GainStage stage;
+        stage.set_gain(gain);
+        stage.begin(64);
+        report("GainStage", time_blocks(source, [&stage](int16_t *data, size_t count) {
+                   stage.process(data, count);
+               }));
+
+        // Once the ramp is over the two should agree to within rounding
+        std::vector<int16_t> a(source.begin(), source.begin() + block_samples);
+        std::vector<int16_t> b = a;
+        old_volume(a.data(), a.size(), gain);
+        stage.process(b.data(), b.size());
+        for (size_t i = 0; i < a.size(); i++) {
+            if (abs(a[i] - b[i]) > 1) {
+                printf("  Sample %zu differs: %d and %d\n", i, a[i], b[i]);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    return ok ? 0 : 1;
+}
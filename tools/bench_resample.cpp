@@ -0,0 +1,98 @@
+/*
+ * Times the sample rate converter used for sound files (see yresample.h) on each common file
+ * rate to the speaker's 16kHz, at each quality setting, and checks that a test tone comes out
+ * at the right level and without drift.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -O2 -std=c++14 -I../include bench_resample.cpp ../src/yresample.cpp -o bench_resample
+ *     ./bench_resample
+ *
+ * The times are for your computer, so compare them with each other rather than with the
+ * Y-Board. The return value is nonzero if any conversion gave the wrong number of samples or
+ * lost the tone.
+ */
+
+#include "yresample.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace YAudio;
+
+static const uint32_t speaker_rate = 16000;
+static const uint32_t file_rates[] = {8000, 11025, 16000, 22050, 24000, 32000, 44100, 48000};
+static const double tone_hz = 1000;
+static const double seconds = 4;
+static const size_t block_samples = 512; // The size of a file block of 16-bit mono samples
+
+static const char *quality_name(Resampler::Quality quality) {
+    switch (quality) {
+    case Resampler::Quality::Fast:
+        return "Fast";
+    case Resampler::Quality::Balanced:
+        return "Balanced";
+    default:
+        return "High";
+    }
+}
+
+// Level of the tone in the output, ignoring the start while the filter fills
+static double tone_level(const std::vector<int16_t> &out) {
+    size_t start = out.size() / 4;
+    double sum = 0;
+    for (size_t i = start; i < out.size(); i++) {
+        sum += (double)out[i] * out[i];
+    }
+    return sqrt(2 * sum / (out.size() - start)) / 32767;
+}
+
+int main() {
+    const Resampler::Quality qualities[] = {Resampler::Quality::Fast,
+                                            Resampler::Quality::Balanced,
+                                            Resampler::Quality::High};
+    bool ok = true;
+
+    printf("%-7s %-9s %12s %10s %8s\n", "Rate", "Quality", "ns/sample", "Samples", "Level");
+    for (uint32_t rate : file_rates) {
+        // A tone at half of full scale
+        std::vector<int16_t> in((size_t)(rate * seconds));
+        for (size_t i = 0; i < in.size(); i++) {
+            in[i] = (int16_t)(16384 * sin(2 * M_PI * tone_hz * i / rate));
+        }
+
+        for (Resampler::Quality quality : qualities) {
+            Resampler resampler;
+            resampler.begin(rate, speaker_rate, quality);
+
+            std::vector<int16_t> out;
+            out.reserve(in.size() * speaker_rate / rate + block_samples);
+            std::vector<int16_t> block(resampler.max_output(block_samples));
+            auto start = std::chrono::steady_clock::now();
+            for (size_t pos = 0; pos < in.size();) {
+                size_t count = std::min(block_samples, in.size() - pos);
+                size_t used = 0;
+                size_t written =
+                    resampler.process(&in[pos], count, used, block.data(), block.size());
+                out.insert(out.end(), block.begin(), block.begin() + written);
+                pos += used;
+            }
+            double ns = std::chrono::duration<double, std::nano>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+
+            double level = tone_level(out);
+            double expected = in.size() * (double)speaker_rate / rate;
+            bool good = fabs(out.size() - expected) <= 2 && fabs(level - 0.5) < 0.03;
+            ok = ok && good;
+
+            printf("%-7u %-9s %12.1f %10zu %8.3f%s\n", (unsigned)rate, quality_name(quality),
+                   ns / out.size(), out.size(), level, good ? "" : "  FAILED");
+        }
+    }
+
+    return ok ? 0 : 1;
+}
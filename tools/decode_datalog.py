@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Converts a data log written by start_data_log (see ydatalog.h) into a CSV file with one row per
+reading, and reports any readings that were lost because the microSD card fell behind.
+
+    python3 decode_datalog.py log.bin log.csv
+"""
+
+import csv
+import struct
+import sys
+
+BLOCK_MAGIC = 0x474F4C59
+BLOCK_SIZE = 512
+HEADER = struct.Struct("<IIHHI")
+RECORD = struct.Struct("<IBBhhh")
+
+CHANNELS = ["accelerometer", "knob", "buttons", "mic_level"]
+
+
+def read_blocks(path):
+    with open(path, "rb") as f:
+        while True:
+            block = f.read(BLOCK_SIZE)
+            if len(block) < BLOCK_SIZE:
+                return
+            magic, sequence, count, dropped, _ = HEADER.unpack_from(block)
+            if magic != BLOCK_MAGIC:
+                # Zeroed space left over from preallocating the file
+                return
+            records = [RECORD.unpack_from(block, HEADER.size + i * RECORD.size)
+                       for i in range(count)]
+            yield sequence, dropped, records
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(f"Usage: {sys.argv[0]} <log.bin> <output.csv>", file=sys.stderr)
+        return 1
+
+    total_records = 0
+    total_dropped = 0
+    expected_sequence = 0
+    last_timestamp = None
+    time_offset = 0
+
+    with open(sys.argv[2], "w", newline="") as out:
+        writer = csv.writer(out)
+        writer.writerow(["time_us", "channel", "value1", "value2", "value3"])
+
+        for sequence, dropped, records in read_blocks(sys.argv[1]):
+            if sequence != expected_sequence:
+                print(f"Warning: blocks {expected_sequence}-{sequence - 1} are missing",
+                      file=sys.stderr)
+            expected_sequence = sequence + 1
+
+            if dropped:
+                print(f"{dropped} readings lost before block {sequence}", file=sys.stderr)
+                total_dropped += dropped
+
+            for timestamp, channel, _, v1, v2, v3 in records:
+                # Timestamps are 32-bit microseconds, which wrap around every 71 minutes
+                if last_timestamp is not None and timestamp < last_timestamp:
+                    time_offset += 1 << 32
+                last_timestamp = timestamp
+
+                name = CHANNELS[channel] if channel < len(CHANNELS) else str(channel)
+                writer.writerow([timestamp + time_offset, name, v1, v2, v3])
+                total_records += 1
+
+    print(f"{total_records} readings decoded, {total_dropped} lost")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
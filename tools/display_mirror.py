@@ -0,0 +1,254 @@
+#!/usr/bin/env python3
+"""
+Shows the Y-Board's display on your computer while Yboard.set_display_mirror(true) is on, and
+reports how many bytes each frame took on the serial port:
+
+    python3 display_mirror.py --port /dev/ttyACM0
+    python3 display_mirror.py --input capture.bin --save-dir frames
+
+Library messages sent on the same port are printed as they arrive. With --save-dir each frame
+is also saved as a PBM image. The packet format is described in include/ymirror.h. This needs
+pyserial (pip install pyserial) to read from a port.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+SYNC = b"\xa5\x5a"
+HEADER = struct.Struct("<2sBHBBBH")
+CHECKSUM_SIZE = 2
+MAX_PAYLOAD = 1024  # More than the badge sends, to reject damaged lengths early
+PACKET_KEY = ord("K")
+PACKET_DELTA = ord("D")
+PACKET_END = ord("E")
+
+
+def fletcher16(data):
+    sum1 = 0
+    sum2 = 0
+    for byte in data:
+        sum1 = (sum1 + byte) % 255
+        sum2 = (sum2 + sum1) % 255
+    return bytes([sum1, sum2])
+
+
+def run_length_decode(payload):
+    out = bytearray()
+    i = 0
+    while i < len(payload):
+        control = payload[i]
+        i += 1
+        if control < 128:
+            out += payload[i:i + control + 1]
+            i += control + 1
+        else:
+            out += payload[i:i + 1] * (control - 125)
+            i += 1
+    return bytes(out)
+
+
+class Decoder:
+    """Rebuilds frames from the serial stream, passing everything else through as text"""
+
+    def __init__(self, on_frame, on_text):
+        self.on_frame = on_frame
+        self.on_text = on_text
+        self.buffer = bytearray()
+        self.width = 0
+        self.pages = []
+        self.stale = []  # For each page, a flag per column that may be wrong until a key packet
+        self.frame = None
+        self.frame_bytes = 0
+        self.frame_segments = 0
+        self.bad_packets = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while True:
+            start = self.buffer.find(SYNC)
+            if start < 0:
+                # Keep a trailing first sync byte, in case the second is still to come
+                keep = 1 if self.buffer.endswith(SYNC[:1]) else 0
+                self.text(self.buffer[:len(self.buffer) - keep])
+                del self.buffer[:len(self.buffer) - keep]
+                return
+            self.text(self.buffer[:start])
+            del self.buffer[:start]
+
+            if len(self.buffer) < HEADER.size:
+                return
+            _, kind, frame, page, x, width, length = HEADER.unpack_from(self.buffer)
+            if kind not in (PACKET_KEY, PACKET_DELTA, PACKET_END) or length > MAX_PAYLOAD:
+                self.reject()
+                continue
+            size = HEADER.size + length + CHECKSUM_SIZE
+            if len(self.buffer) < size:
+                return
+            packet = bytes(self.buffer[:size])
+            if fletcher16(packet[2:size - CHECKSUM_SIZE]) != packet[size - CHECKSUM_SIZE:]:
+                self.reject()
+                continue
+            del self.buffer[:size]
+            self.packet(kind, frame, page, x, width, packet[HEADER.size:size - CHECKSUM_SIZE],
+                        size)
+
+    def text(self, data):
+        if data:
+            self.on_text(data.decode("utf-8", "replace"))
+
+    def reject(self):
+        # Not a packet after all, or a damaged one. Skip the sync bytes and look again.
+        self.bad_packets += 1
+        self.stale = [bytearray(b"\x01" * self.width) for _ in self.pages]
+        self.text(self.buffer[:1])
+        del self.buffer[:1]
+
+    def packet(self, kind, frame, page, x, width, payload, size):
+        # The end of the last frame wasn't sent if the port was busy, so this one ends it
+        if frame != self.frame and self.frame_segments:
+            self.end_frame(self.frame, len(self.pages), self.width)
+        self.frame = frame
+        self.frame_bytes += size
+        if kind == PACKET_END:
+            self.end_frame(frame, page, width)
+            return
+
+        if width != self.width or page >= len(self.pages):
+            self.resize(width, max(page + 1, len(self.pages)))
+        data = run_length_decode(payload)
+        end = x + len(data)
+        if not data or end > width:
+            self.stale[page][x:] = b"\x01" * (width - min(x, width))
+            return
+
+        row = self.pages[page]
+        if kind == PACKET_KEY:
+            self.stale[page][x:end] = bytes(len(data))
+        else:
+            data = bytes(a ^ b for a, b in zip(row[x:end], data))
+        self.pages[page] = row[:x] + data + row[end:]
+        self.frame_segments += 1
+
+    def end_frame(self, frame, page_count, width):
+        if width != self.width or page_count != len(self.pages):
+            self.resize(width, page_count)
+
+        stale = [page for page, flags in enumerate(self.stale) if any(flags)]
+        self.on_frame(frame, self.width, self.pages, self.frame_segments, self.frame_bytes, stale)
+        self.frame_bytes = 0
+        self.frame_segments = 0
+
+    def resize(self, width, page_count):
+        if width != self.width:
+            self.pages = []
+            self.stale = []
+        self.width = width
+        while len(self.pages) < page_count:
+            self.stale.append(bytearray(b"\x01" * width))
+            self.pages.append(bytes(width))
+        del self.pages[page_count:]
+        del self.stale[page_count:]
+
+
+def pixel(pages, width, x, y):
+    return (pages[y // 8][x] >> (y % 8)) & 1
+
+
+def save_pbm(path, width, pages):
+    height = len(pages) * 8
+    rows = bytearray()
+    for y in range(height):
+        for x in range(0, width, 8):
+            bits = 0
+            for i in range(8):
+                if x + i < width and pixel(pages, width, x + i, y):
+                    bits |= 0x80 >> i
+            rows.append(bits)
+    with open(path, "wb") as f:
+        f.write(b"P4\n%d %d\n" % (width, height))
+        f.write(rows)
+
+
+def draw(width, pages):
+    # Two rows of pixels per line of text
+    lines = []
+    for y in range(0, len(pages) * 8, 2):
+        line = ""
+        for x in range(width):
+            top = pixel(pages, width, x, y)
+            bottom = pixel(pages, width, x, y + 1)
+            line += " ▀▄█"[top | bottom << 1]
+        lines.append(line)
+    return "\n".join(lines)
+
+
+def open_input(args):
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            raise OSError("reading from a port needs pyserial (pip install pyserial)")
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        return lambda: port.read(4096)
+    f = open(args.input, "rb") if args.input else sys.stdin.buffer
+    return lambda: f.read(4096) or None
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Show the Y-Board display mirrored over serial")
+    source = parser.add_mutually_exclusive_group()
+    source.add_argument("--port", help="serial port the Y-Board is on")
+    source.add_argument("--input", help="file of captured serial data (default: stdin)")
+    parser.add_argument("--baud", type=int, default=115200, help="serial speed")
+    parser.add_argument("--save-dir", help="folder to save each frame to as a PBM image")
+    parser.add_argument("--draw", action="store_true", help="draw each frame in the terminal")
+    parser.add_argument("--quiet", action="store_true", help="don't print library messages")
+    args = parser.parse_args()
+
+    totals = {"frames": 0, "bytes": 0}
+
+    def on_frame(frame, width, pages, changed, size, stale):
+        totals["frames"] += 1
+        totals["bytes"] += size
+        raw = width * len(pages)
+        note = ", stale pages %s" % stale if stale else ""
+        print("[frame %5d] %d segments changed, %d bytes (%.0f%% of %d), average %.0f bytes%s" %
+              (frame, changed, size, 100.0 * size / raw if raw else 0, raw,
+               totals["bytes"] / totals["frames"], note))
+        if args.draw:
+            print(draw(width, pages))
+        if args.save_dir:
+            save_pbm(os.path.join(args.save_dir, "frame%05d.pbm" % totals["frames"]), width,
+                     pages)
+
+    def on_text(text):
+        if not args.quiet:
+            sys.stdout.write(text)
+
+    try:
+        if args.save_dir:
+            os.makedirs(args.save_dir, exist_ok=True)
+        read = open_input(args)
+        decoder = Decoder(on_frame, on_text)
+        while True:
+            data = read()
+            if data is None:
+                break
+            decoder.feed(data)
+    except KeyboardInterrupt:
+        pass
+    except OSError as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+
+    if totals["frames"]:
+        print("%d frames, %d bytes, %.0f bytes per frame, %d damaged packets" %
+              (totals["frames"], totals["bytes"], totals["bytes"] / totals["frames"],
+               decoder.bad_packets))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
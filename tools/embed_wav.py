@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+"""
+Turns a WAV file into a header file holding the file as a const array, so the sound is built
+into the program and can be played with play_asset without a microSD card:
+
+    python3 embed_wav.py beep.wav beep.h --name beep
+    python3 embed_wav.py voice.wav voice.h --name voice --adpcm
+
+--adpcm compresses 16-bit PCM to IMA ADPCM, which takes a quarter of the space and is decoded
+as it plays. The header defines <name>_data and a YAudio::sound_asset_t called <name>.
+"""
+
+import argparse
+import re
+import struct
+import sys
+import wave
+
+STEP_TABLE = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60,
+    66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371,
+    408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878,
+    2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845,
+    8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086,
+    29794, 32767,
+]
+INDEX_TABLE = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+
+class AdpcmChannel:
+    def __init__(self):
+        self.predictor = 0
+        self.index = 0
+
+    def encode(self, sample):
+        step = STEP_TABLE[self.index]
+        diff = sample - self.predictor
+        code = 0
+        if diff < 0:
+            code = 8
+            diff = -diff
+        for bit in (4, 2, 1):
+            if diff >= step:
+                code |= bit
+                diff -= step
+            step >>= 1
+
+        # Track the decoder exactly, so errors don't build up
+        step = STEP_TABLE[self.index]
+        delta = step >> 3
+        if code & 1:
+            delta += step >> 2
+        if code & 2:
+            delta += step >> 1
+        if code & 4:
+            delta += step
+        if code & 8:
+            delta = -delta
+        self.predictor = max(-32768, min(32767, self.predictor + delta))
+        self.index = max(0, min(88, self.index + INDEX_TABLE[code]))
+        return code
+
+
+def encode_adpcm(samples, channels, rate):
+    block_align = (256 if rate <= 11025 else 512 if rate <= 22050 else 1024) * channels
+    block_align = min(block_align, 1024)
+    frames_per_block = (block_align - 4 * channels) * 2 // channels + 1
+
+    frames = [samples[i:i + channels] for i in range(0, len(samples), channels)]
+    frame_count = len(frames)
+    if frames:
+        # Pad the last block with its final frame, so every block is whole. The fact chunk holds
+        # the real length, and the player stops there.
+        frames += [frames[-1]] * (-len(frames) % frames_per_block)
+
+    state = [AdpcmChannel() for _ in range(channels)]
+    data = bytearray()
+    for start in range(0, len(frames), frames_per_block):
+        block = frames[start:start + frames_per_block]
+        for ch in range(channels):
+            state[ch].predictor = block[0][ch]
+            data += struct.pack("<hBB", block[0][ch], state[ch].index, 0)
+
+        codes = [[state[ch].encode(frame[ch]) for frame in block[1:]] for ch in range(channels)]
+        if channels == 1:
+            for i in range(0, len(codes[0]), 2):
+                data.append(codes[0][i] | (codes[0][i + 1] << 4))
+        else:
+            # 4 bytes (8 samples) of each channel in turn
+            for group in range(0, len(codes[0]), 8):
+                for ch in range(channels):
+                    for i in range(group, group + 8, 2):
+                        data.append(codes[ch][i] | (codes[ch][i + 1] << 4))
+
+    byte_rate = rate * block_align // frames_per_block
+    fmt = struct.pack("<HHIIHHHH", 0x11, channels, rate, byte_rate, block_align, 4, 2,
+                      frames_per_block)
+    fact = struct.pack("<I", frame_count)
+    return riff([(b"fmt ", fmt), (b"fact", fact), (b"data", bytes(data))])
+
+
+def riff(chunks):
+    body = b"WAVE"
+    for name, data in chunks:
+        body += name + struct.pack("<I", len(data)) + data + (b"\0" if len(data) & 1 else b"")
+    return b"RIFF" + struct.pack("<I", len(body)) + body
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Embed a WAV file as a C++ array")
+    parser.add_argument("input", help="16-bit PCM WAV file")
+    parser.add_argument("output", help="header file to write")
+    parser.add_argument("--name", help="name of the sound (defaults to the file name)")
+    parser.add_argument("--adpcm", action="store_true", help="compress to IMA ADPCM")
+    args = parser.parse_args()
+
+    name = args.name or re.sub(r"\W", "_", args.input.rsplit("/", 1)[-1].rsplit(".", 1)[0])
+
+    if args.adpcm:
+        with wave.open(args.input, "rb") as w:
+            if w.getsampwidth() != 2 or w.getnchannels() > 2:
+                print("Error: --adpcm needs a 16-bit mono or stereo WAV file", file=sys.stderr)
+                return 1
+            raw = w.readframes(w.getnframes())
+            samples = struct.unpack("<%dh" % (len(raw) // 2), raw)
+            data = encode_adpcm(samples, w.getnchannels(), w.getframerate())
+    else:
+        with open(args.input, "rb") as f:
+            data = f.read()
+        if data[:4] != b"RIFF" or data[8:12] != b"WAVE":
+            print("Error: %s is not a WAV file" % args.input, file=sys.stderr)
+            return 1
+
+    with open(args.output, "w") as out:
+        out.write("// Made from %s by embed_wav.py\n" % args.input.rsplit("/", 1)[-1])
+        out.write("#pragma once\n\n#include \"yaudio.h\"\n\n")
+        out.write("alignas(4) static const uint8_t %s_data[%d] = {\n" % (name, len(data)))
+        for i in range(0, len(data), 16):
+            out.write("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",\n")
+        out.write("};\n\n")
+        out.write("static const YAudio::sound_asset_t %s = {%s_data, sizeof(%s_data)};\n" %
+                  (name, name, name))
+
+    print("%s: %d bytes" % (name, len(data)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,122 @@
+#!/usr/bin/env python3
+"""
+Packs WAV and MP3 files into one sound pack file for the microSD card, so the badge can find
+and start any of them without searching the card's directories:
+
+    python3 pack_assets.py sounds.ypak beep.wav music/intro.mp3 ...
+    python3 pack_assets.py sounds.ypak --list
+
+Sounds are named by their file name without the folder (beep.wav, intro.mp3). A pack called
+sounds.ypak in the top folder of the card is opened automatically by Yboard.setup(), and its
+sounds are played with Yboard.play_sound_pack("beep.wav"). The file format is described in
+include/ypack.h.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+VERSION = 1
+HEADER_SIZE = 16
+ENTRY_SIZE = 16
+ALIGNMENT = 512
+FORMAT_WAV = 0
+FORMAT_MP3 = 1
+FORMAT_NAMES = {FORMAT_WAV: "WAV", FORMAT_MP3: "MP3"}
+
+
+def fnv1a(name):
+    value = 2166136261
+    for byte in name.encode("utf-8"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def sound_format(data):
+    if data[:4] == b"RIFF" and data[8:12] == b"WAVE":
+        return FORMAT_WAV
+    if data[:3] == b"ID3" or data[:1] in (b"\xff", b"\xfe"):
+        return FORMAT_MP3
+    return None
+
+
+def write_pack(output, inputs):
+    names = [os.path.basename(path) for path in inputs]
+    hashes = {}
+    for name in names:
+        value = fnv1a(name)
+        if value in hashes:
+            if hashes[value] == name:
+                raise ValueError("%s is in the pack twice" % name)
+            raise ValueError("%s and %s have the same hash, rename one" % (hashes[value], name))
+        hashes[value] = name
+
+    name_blob = b"".join(name.encode("utf-8") + b"\0" for name in names)
+    offset = HEADER_SIZE + ENTRY_SIZE * len(inputs) + len(name_blob)
+
+    entries = []
+    sounds = []
+    for path, name in zip(inputs, names):
+        with open(path, "rb") as f:
+            data = f.read()
+        fmt = sound_format(data)
+        if fmt is None:
+            raise ValueError("%s is not a WAV or MP3 file" % path)
+
+        # Align each sound to a card sector, so reading it doesn't straddle sectors needlessly
+        offset += -offset % ALIGNMENT
+        entries.append(struct.pack("<IIIB3x", fnv1a(name), offset, len(data), fmt))
+        sounds.append((offset, data))
+        offset += len(data)
+
+    with open(output, "wb") as out:
+        out.write(b"YPAK" + struct.pack("<B3xII", VERSION, len(inputs), len(name_blob)))
+        out.write(b"".join(entries))
+        out.write(name_blob)
+        for start, data in sounds:
+            out.write(b"\0" * (start - out.tell()))
+            out.write(data)
+
+
+def list_pack(path):
+    with open(path, "rb") as f:
+        header = f.read(HEADER_SIZE)
+        if header[:4] != b"YPAK" or header[4] != VERSION:
+            raise ValueError("%s is not a sound pack" % path)
+        count, names_size = struct.unpack("<II", header[8:16])
+        entries = [struct.unpack("<IIIB3x", f.read(ENTRY_SIZE)) for _ in range(count)]
+        names = f.read(names_size).split(b"\0")
+
+    for (_, offset, length, fmt), name in zip(entries, names):
+        print("%-32s %s %9d bytes at %d" % (name.decode("utf-8"), FORMAT_NAMES.get(fmt, "?"),
+                                            length, offset))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Pack sound files into a sound pack")
+    parser.add_argument("output", help="sound pack file to write (or read with --list)")
+    parser.add_argument("inputs", nargs="*", help="WAV and MP3 files to pack")
+    parser.add_argument("--list", action="store_true", help="list the sounds in a pack")
+    args = parser.parse_args()
+
+    try:
+        if args.list:
+            list_pack(args.output)
+            return 0
+        if not args.inputs:
+            parser.error("no sound files given")
+        if len(args.inputs) > 0xFFFE:
+            raise ValueError("too many sounds for one pack")
+        write_pack(args.output, args.inputs)
+    except (OSError, ValueError) as error:
+        print("Error: %s" % error, file=sys.stderr)
+        return 1
+
+    print("%s: %d sounds, %d bytes" % (args.output, len(args.inputs),
+                                       os.path.getsize(args.output)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
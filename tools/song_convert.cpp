@@ -0,0 +1,74 @@
+/*
+ * Converts a text file of notes (in the syntax documented for play_notes in yboard.h) into a
+ * binary song file that can be played from the microSD card with play_song_file.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -std=c++14 -I../include song_convert.cpp -o song_convert
+ *     ./song_convert song.txt song.ysong
+ */
+
+#include "ysong.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace YAudio;
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <notes.txt> <output.ysong>" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1]);
+    if (!input) {
+        std::cerr << "Error opening " << argv[1] << std::endl;
+        return 1;
+    }
+    std::stringstream text;
+    text << input.rdbuf();
+    std::string notes = text.str();
+
+    std::vector<uint8_t> events;
+    song_detail::state_t st = song_detail::start(notes.c_str());
+    note_event_t event{};
+    uint32_t count = 0;
+
+    while (1) {
+        size_t pos = st.pos;
+        song_detail::Status status = song_detail::next_event(st, event);
+
+        if (status == song_detail::Status::End) {
+            break;
+        }
+        if (status == song_detail::Status::Error) {
+            std::cerr << "Syntax error at character " << pos << ": "
+                      << notes.substr(pos, 20) << std::endl;
+            return 1;
+        }
+
+        uint8_t packed[song_file_event_size];
+        encode_song_event(event, packed);
+        events.insert(events.end(), packed, packed + sizeof(packed));
+        count++;
+    }
+
+    uint8_t header[song_file_header_size];
+    encode_song_header(count, header);
+
+    std::ofstream output(argv[2], std::ios::binary);
+    output.write((const char *)header, sizeof(header));
+    output.write((const char *)events.data(), events.size());
+    if (!output) {
+        std::cerr << "Error writing " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << count << " notes (" << sizeof(header) + events.size() << " bytes)"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * Checks the speaker's filters (see yfilter.h) by playing tones through each design and
+ * comparing the measured gain with the response worked out from the Audio EQ Cookbook
+ * formulas, then times the effects chain with every stage in use.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -O2 -std=c++14 -I../include test_filter.cpp ../src/yfilter.cpp -o test_filter
+ *     ./test_filter
+ *
+ * The times are for your computer, so compare them with each other rather than with the
+ * Y-Board. The return value is nonzero if any measured gain is off by more than 0.1dB.
+ */
+
+#include "yfilter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <vector>
+
+using namespace YAudio;
+
+static const uint32_t sample_rate = 16000;
+static const double tone_amplitude = 4096; // Leaves room for a 12dB boost
+static const double tolerance_db = 0.1;
+
+struct design_t {
+    const char *name;
+    FilterType type;
+    float frequency;
+    float q;
+    float gain_db;
+};
+
+static const design_t designs[] = {
+    {"High pass 200Hz", FilterType::HighPass, 200, 0.7071f, 0},
+    {"Low pass 3kHz", FilterType::LowPass, 3000, 0.7071f, 0},
+    {"Low shelf 300Hz +6dB", FilterType::LowShelf, 300, 0.7071f, 6},
+    {"High shelf 4kHz -9dB", FilterType::HighShelf, 4000, 0.7071f, -9},
+    {"Peaking 1kHz +12dB", FilterType::Peaking, 1000, 2, 12},
+    {"Peaking 2.5kHz -20dB", FilterType::Peaking, 2500, 4, -20},
+    {"Peaking 1kHz +20dB (limited)", FilterType::Peaking, 1000, 2, 20},
+};
+
+static const double test_frequencies[] = {50, 200, 1000, 2500, 4000, 7000};
+
+// The cookbook coefficients in floating point, b0 b1 b2 a0 a1 a2
+static void cookbook(const design_t &design, double c[6]) {
+    double gain_db = design.gain_db > Biquad::max_gain_db ? Biquad::max_gain_db : design.gain_db;
+    double w0 = 2 * M_PI * design.frequency / sample_rate;
+    double cos_w0 = cos(w0);
+    double alpha = sin(w0) / (2 * design.q);
+    double a = pow(10, gain_db / 40);
+    double root_a = 2 * sqrt(a) * alpha;
+
+    switch (design.type) {
+    case FilterType::HighPass:
+        c[0] = (1 + cos_w0) / 2, c[1] = -(1 + cos_w0), c[2] = (1 + cos_w0) / 2;
+        c[3] = 1 + alpha, c[4] = -2 * cos_w0, c[5] = 1 - alpha;
+        break;
+    case FilterType::LowPass:
+        c[0] = (1 - cos_w0) / 2, c[1] = 1 - cos_w0, c[2] = (1 - cos_w0) / 2;
+        c[3] = 1 + alpha, c[4] = -2 * cos_w0, c[5] = 1 - alpha;
+        break;
+    case FilterType::LowShelf:
+        c[0] = a * ((a + 1) - (a - 1) * cos_w0 + root_a);
+        c[1] = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+        c[2] = a * ((a + 1) - (a - 1) * cos_w0 - root_a);
+        c[3] = (a + 1) + (a - 1) * cos_w0 + root_a;
+        c[4] = -2 * ((a - 1) + (a + 1) * cos_w0);
+        c[5] = (a + 1) + (a - 1) * cos_w0 - root_a;
+        break;
+    case FilterType::HighShelf:
+        c[0] = a * ((a + 1) + (a - 1) * cos_w0 + root_a);
+        c[1] = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+        c[2] = a * ((a + 1) + (a - 1) * cos_w0 - root_a);
+        c[3] = (a + 1) - (a - 1) * cos_w0 + root_a;
+        c[4] = 2 * ((a - 1) - (a + 1) * cos_w0);
+        c[5] = (a + 1) - (a - 1) * cos_w0 - root_a;
+        break;
+    case FilterType::Peaking:
+        c[0] = 1 + alpha * a, c[1] = -2 * cos_w0, c[2] = 1 - alpha * a;
+        c[3] = 1 + alpha / a, c[4] = -2 * cos_w0, c[5] = 1 - alpha / a;
+        break;
+    default:
+        c[0] = c[3] = 1, c[1] = c[2] = c[4] = c[5] = 0;
+        break;
+    }
+}
+
+// |H(e^jw)| in dB
+static double expected_gain_db(const design_t &design, double frequency) {
+    double c[6];
+    cookbook(design, c);
+    std::complex<double> z1 = std::polar(1.0, -2 * M_PI * frequency / sample_rate);
+    std::complex<double> z2 = z1 * z1;
+    std::complex<double> h = (c[0] + c[1] * z1 + c[2] * z2) / (c[3] + c[4] * z1 + c[5] * z2);
+    return 20 * log10(std::abs(h));
+}
+
+// Plays a tone through the filter and measures the gain of the output at the tone's frequency,
+// which leaves out the rounding noise
+static double measured_gain_db(const design_t &design, double frequency) {
+    Biquad filter;
+    filter.design(design.type, sample_rate, design.frequency, design.q, design.gain_db);
+
+    // Half a second to settle, then a whole number of cycles over about a second
+    size_t settle = sample_rate / 2;
+    size_t cycles = (size_t)frequency;
+    size_t length = (size_t)lround(cycles * sample_rate / frequency);
+    std::vector<int16_t> samples(settle + length);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)lround(tone_amplitude * sin(2 * M_PI * frequency * i / sample_rate));
+    }
+    filter.process(samples.data(), samples.size());
+
+    std::complex<double> sum = 0;
+    for (size_t i = 0; i < length; i++) {
+        sum += (double)samples[settle + i] *
+               std::polar(1.0, -2 * M_PI * frequency * (settle + i) / sample_rate);
+    }
+    return 20 * log10(2 * std::abs(sum) / length / tone_amplitude);
+}
+
+int main() {
+    bool ok = true;
+
+    for (const design_t &design : designs) {
+        printf("%s\n", design.name);
+        for (double frequency : test_frequencies) {
+            double expected = expected_gain_db(design, frequency);
+            double measured = measured_gain_db(design, frequency);
+            bool good = fabs(measured - expected) <= tolerance_db;
+            ok = ok && good;
+            printf("  %6.0fHz  expected %7.2fdB  measured %7.2fdB%s\n", frequency, expected,
+                   measured, good ? "" : "  FAILED");
+        }
+    }
+
+    // A minute of a tone loud enough to keep the limiter busy, in the speaker's block size
+    EffectsChain chain;
+    chain.begin(sample_rate);
+    chain.set_filter(0, FilterType::HighPass, 150, 0.7071f, 0);
+    chain.set_filter(1, FilterType::LowShelf, 300, 0.7071f, 4);
+    chain.set_filter(2, FilterType::Peaking, 2000, 1.5f, -3);
+    chain.set_filter(3, FilterType::LowPass, 6000, 0.7071f, 0);
+    chain.set_limiter(-6, 2, 50);
+    chain.set_bypass(EffectsChain::limiter_stage, false);
+
+    const size_t block_samples = 128;
+    const size_t total_samples = sample_rate * 60;
+    std::vector<int16_t> source(sample_rate + block_samples);
+    for (size_t i = 0; i < source.size(); i++) {
+        source[i] = (int16_t)(24000 * sin(2 * M_PI * 440 * i / sample_rate));
+    }
+    std::vector<int16_t> block(block_samples);
+    chain.reset_stats();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < total_samples; pos += block_samples) {
+        size_t offset = pos % sample_rate;
+        std::copy(source.begin() + offset, source.begin() + offset + block_samples,
+                  block.begin());
+        chain.process(block.data(), block_samples);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+                    .count();
+
+    printf("Effects chain, ns per sample:\n");
+    for (int stage = 0; stage < EffectsChain::stage_count; stage++) {
+        printf("  %-8s %6.2f\n", stage == EffectsChain::limiter_stage ? "Limiter" : "Filter",
+               chain.get_cycles_per_sample(stage));
+    }
+    printf("  %-8s %6.2f (%.2f%% of real time)\n", "Total", ns / total_samples,
+           100 * ns / total_samples * sample_rate / 1e9);
+
+    return ok ? 0 : 1;
+}
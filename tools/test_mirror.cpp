@@ -0,0 +1,154 @@
+/*
+ * Checks the display mirror (see ymirror.h) against a serial port that, like the Y-Board's
+ * without a transmit buffer, only takes a write when its 128 byte FIFO has room for all of it.
+ * Frames of dense text and of a moving ball are sent through it and decoded again, and the
+ * receiver's copy has to catch up with the display once it stops changing.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -O2 -std=c++14 -I../include test_mirror.cpp ../src/ymirror.cpp -o test_mirror
+ *     ./test_mirror
+ *
+ * The return value is nonzero if a packet was too big for the FIFO, was damaged, or the
+ * receiver's copy didn't catch up.
+ */
+
+#include "ylog.h"
+#include "ymirror.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace YMirror;
+
+static const int width = 128;
+static const int pages = 8;
+static const size_t fifo_bytes = 128;
+static const size_t drained_per_frame = 115200 / 10 / 30; // 115200 baud at 30 frames a second
+
+// The serial port: what has been written, and how full the FIFO is
+static std::vector<uint8_t> stream;
+static size_t fifo_used = 0;
+static size_t largest_packet = 0;
+
+bool YLog::write_binary(const uint8_t *data, size_t len) {
+    largest_packet = len > largest_packet ? len : largest_packet;
+    if (fifo_used + len > fifo_bytes) {
+        return false;
+    }
+    fifo_used += len;
+    stream.insert(stream.end(), data, data + len);
+    return true;
+}
+
+// Applies the packets in the stream to screen, the receiver's copy. Returns false if any packet
+// is damaged or doesn't fit the display.
+static bool receive(std::vector<uint8_t> &screen) {
+    size_t pos = 0;
+    while (pos + header_size <= stream.size()) {
+        const uint8_t *p = &stream[pos];
+        size_t len = p[8] | (p[9] << 8);
+        if (p[0] != sync_bytes[0] || p[1] != sync_bytes[1] ||
+            pos + header_size + len + checksum_size > stream.size()) {
+            return false;
+        }
+
+        uint16_t sum1 = 0;
+        uint16_t sum2 = 0;
+        for (size_t i = 2; i < header_size + len; i++) {
+            sum1 = (sum1 + p[i]) % 255;
+            sum2 = (sum2 + sum1) % 255;
+        }
+        if (p[header_size + len] != sum1 || p[header_size + len + 1] != sum2) {
+            return false;
+        }
+
+        if (p[2] != packet_end) {
+            std::vector<uint8_t> data;
+            for (size_t i = 0; i < len;) {
+                uint8_t control = p[header_size + i++];
+                if (control < 128) {
+                    data.insert(data.end(), p + header_size + i, p + header_size + i + control + 1);
+                    i += control + 1;
+                } else {
+                    data.insert(data.end(), control - 125, p[header_size + i++]);
+                }
+            }
+
+            int page = p[5];
+            int x = p[6];
+            if (page >= pages || p[7] != width || x + data.size() > (size_t)width) {
+                return false;
+            }
+            for (size_t i = 0; i < data.size(); i++) {
+                uint8_t &pixel = screen[page * width + x + i];
+                pixel = p[2] == packet_key ? data[i] : pixel ^ data[i];
+            }
+        }
+        pos += header_size + len + checksum_size;
+    }
+    stream.erase(stream.begin(), stream.begin() + pos);
+    return true;
+}
+
+// Text-like noise on every page, which has no runs for the encoder to shorten
+static void draw_text(std::vector<uint8_t> &display, int frame) {
+    uint32_t seed = 12345 + frame;
+    for (uint8_t &column : display) {
+        seed = seed * 1103515245 + 12345;
+        column = seed >> 24;
+    }
+}
+
+static void draw_ball(std::vector<uint8_t> &display, int frame) {
+    std::fill(display.begin(), display.end(), 0);
+    int x = (frame * 3) % (width - 8);
+    int page = (frame / 8) % pages;
+    for (int i = 0; i < 8; i++) {
+        display[page * width + x + i] = 0x3C;
+    }
+}
+
+static bool run(const char *name, void (*draw)(std::vector<uint8_t> &, int), int frames) {
+    DisplayMirror mirror;
+    mirror.begin(width, pages);
+    std::vector<uint8_t> display(width * pages);
+    std::vector<uint8_t> screen(width * pages);
+    stream.clear();
+    fifo_used = 0;
+
+    bool ok = true;
+    int caught_up = -1;
+    for (int frame = 0; frame < frames * 2 && ok; frame++) {
+        // The display changes for the first half, then holds still
+        if (frame < frames) {
+            draw(display, frame);
+        }
+        mirror.send(display.data());
+        ok = receive(screen);
+        fifo_used = fifo_used > drained_per_frame ? fifo_used - drained_per_frame : 0;
+
+        if (frame >= frames && caught_up < 0 && screen == display) {
+            caught_up = frame - frames;
+        }
+    }
+
+    ok = ok && caught_up >= 0;
+    printf("%-6s %u bytes, %u pages deferred, caught up %d frames after the last change%s\n",
+           name, (unsigned)mirror.get_bytes_sent(), (unsigned)mirror.get_pages_deferred(),
+           caught_up, ok ? "" : "  FAILED");
+    return ok;
+}
+
+int main() {
+    bool ok = run("Text", draw_text, 40);
+    ok = run("Ball", draw_ball, 200) && ok;
+
+    bool fits = largest_packet <= YLog::max_binary_write;
+    printf("Largest packet %u bytes, the FIFO holds %u%s\n", (unsigned)largest_packet,
+           (unsigned)fifo_bytes, fits ? "" : "  FAILED");
+
+    return ok && fits ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+/*
+ * Checks the fixed-point angle maths used by start_orientation (see yangles.h) against the C
+ * library's floating point versions, and times them.
+ *
+ * Build and run on your computer (not the Y-Board):
+ *
+ *     g++ -O2 -std=c++14 -I../include test_orientation.cpp ../src/yangles.cpp -o test_orientation
+ *     ./test_orientation
+ *
+ * The times are for your computer, whose floating point hardware flatters the C library: the
+ * Y-Board's processor only has hardware for floats, not doubles. The return value is nonzero
+ * if any angle is off by more than 0.1 degree or any square root isn't the nearest whole number.
+ */
+
+#include "yangles.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace YOrientation;
+
+static const double max_error_degrees = 0.1;
+static const size_t random_readings = 1000000;
+
+// Difference between two angles in degrees, allowing for wrapping at 180
+static double angle_error(double a, double b) {
+    double error = fabs(a - b);
+    return error > 180 ? 360 - error : error;
+}
+
+static bool check_atan2() {
+    // Every direction in steps of a tenth of a degree, at lengths from a few milli-g upwards
+    const double lengths[] = {5, 100, 1000, 16000, 1e6, 2e9};
+    double worst = 0;
+    for (double length : lengths) {
+        for (int step = -1800; step <= 1800; step++) {
+            double angle = step * M_PI / 1800;
+            int32_t y = (int32_t)lround(length * sin(angle));
+            int32_t x = (int32_t)lround(length * cos(angle));
+            double error = angle_error(fast_atan2(y, x) / 100.0, atan2(y, x) * 180 / M_PI);
+            worst = fmax(worst, error);
+        }
+    }
+    bool ok = worst <= max_error_degrees;
+    printf("fast_atan2 worst error %.3f degrees%s\n", worst, ok ? "" : "  FAILED");
+    return ok;
+}
+
+static bool check_sqrt() {
+    // Every value up to 2^24, and then spread across the rest of the range and near squares
+    uint32_t wrong = 0;
+    for (uint32_t value = 0; value < (1u << 24); value++) {
+        if (fast_sqrt(value) != (uint32_t)lround(sqrt((double)value))) {
+            wrong++;
+        }
+    }
+    std::mt19937 random(1);
+    for (size_t i = 0; i < random_readings; i++) {
+        uint32_t value = random();
+        uint32_t root = (uint32_t)sqrt((double)value);
+        const uint32_t near[] = {value, root * root, root * root + root, root * root + root + 1};
+        for (uint32_t n : near) {
+            if (fast_sqrt(n) != (uint32_t)lround(sqrt((double)n))) {
+                wrong++;
+            }
+        }
+    }
+    printf("fast_sqrt %u wrong%s\n", (unsigned)wrong, wrong ? "  FAILED" : "");
+    return wrong == 0;
+}
+
+struct reading_t {
+    int32_t x, y, z;
+};
+
+static void solve_libm(int32_t x, int32_t y, int32_t z, double angles[3]) {
+    angles[0] = atan2(-x, sqrt((double)y * y + (double)z * z)) * 180 / M_PI;
+    angles[1] = atan2(y, z) * 180 / M_PI;
+    angles[2] = atan2(sqrt((double)x * x + (double)y * y), z) * 180 / M_PI;
+}
+
+static bool check_solve(const std::vector<reading_t> &readings) {
+    double worst[3] = {};
+    for (const reading_t &r : readings) {
+        estimate_t estimate;
+        solve(r.x, r.y, r.z, estimate);
+        double expected[3];
+        solve_libm(r.x, r.y, r.z, expected);
+        worst[0] = fmax(worst[0], angle_error(estimate.pitch / 100.0, expected[0]));
+        worst[1] = fmax(worst[1], angle_error(estimate.roll / 100.0, expected[1]));
+        worst[2] = fmax(worst[2], angle_error(estimate.tilt / 100.0, expected[2]));
+    }
+    bool ok = fmax(worst[0], fmax(worst[1], worst[2])) <= max_error_degrees;
+    printf("solve worst error pitch %.3f, roll %.3f, tilt %.3f degrees%s\n", worst[0], worst[1],
+           worst[2], ok ? "" : "  FAILED");
+    return ok;
+}
+
+static void time_solve(const std::vector<reading_t> &readings) {
+    int64_t sum = 0; // Keeps the compiler from skipping the work
+    auto start = std::chrono::steady_clock::now();
+    for (const reading_t &r : readings) {
+        estimate_t estimate;
+        solve(r.x, r.y, r.z, estimate);
+        sum += estimate.pitch + estimate.roll + estimate.tilt;
+    }
+    double fixed_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() /
+        readings.size();
+
+    double double_sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const reading_t &r : readings) {
+        double angles[3];
+        solve_libm(r.x, r.y, r.z, angles);
+        double_sum += angles[0] + angles[1] + angles[2];
+    }
+    double double_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() /
+        readings.size();
+
+    float float_sum = 0;
+    start = std::chrono::steady_clock::now();
+    for (const reading_t &r : readings) {
+        float x = r.x, y = r.y, z = r.z;
+        float_sum += atan2f(-x, sqrtf(y * y + z * z)) + atan2f(y, z) +
+                     atan2f(sqrtf(x * x + y * y), z);
+    }
+    double float_ns =
+        std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() /
+        readings.size();
+
+    printf("ns per reading: solve %.1f, C library doubles %.1f, floats %.1f (%lld %.0f %.0f)\n",
+           fixed_ns, double_ns, float_ns, (long long)sum, double_sum, float_sum);
+}
+
+int main() {
+    // Gravity in random directions, at the strengths the accelerometer sees when held or shaken
+    std::mt19937 random(2);
+    std::normal_distribution<double> direction(0, 1);
+    std::uniform_real_distribution<double> strength(200, 4000);
+    std::vector<reading_t> readings(random_readings);
+    for (reading_t &r : readings) {
+        double x = direction(random), y = direction(random), z = direction(random);
+        double scale = strength(random) / sqrt(x * x + y * y + z * z);
+        r = {(int32_t)lround(x * scale), (int32_t)lround(y * scale), (int32_t)lround(z * scale)};
+    }
+
+    bool ok = check_atan2();
+    ok = check_sqrt() && ok;
+    ok = check_solve(readings) && ok;
+    time_solve(readings);
+
+    return ok ? 0 : 1;
+}